@@ -8,10 +8,16 @@
 
 namespace pog {
 
+/**
+ * Shift of the token into the given state. If reset_value is set, the value of the token
+ * is replaced with default value because the state is entered only after skipping reductions
+ * by unit rules without action (see ParsingTable).
+ */
 template <typename ValueT>
 struct Shift
 {
 	const State<ValueT>* state;
+	bool reset_value;
 };
 
 template <typename ValueT>
@@ -22,6 +28,16 @@ struct Reduce
 
 struct Accept {};
 
+/**
+ * Record of GOTO table. Meaning of reset_value is the same as in Shift.
+ */
+template <typename ValueT>
+struct Goto
+{
+	const State<ValueT>* state;
+	bool reset_value;
+};
+
 template <typename ValueT>
 using Action = std::variant<Shift<ValueT>, Reduce<ValueT>, Accept>;
 
@@ -1,11 +1,16 @@
 #pragma once
 
+#include <algorithm>
+#include <cassert>
 #include <deque>
 #include <memory>
+#include <optional>
 #include <vector>
 
+#include <pog/bitset.h>
 #include <pog/grammar.h>
 #include <pog/state.h>
+#include <pog/types/state_and_rule.h>
 #include <pog/types/state_and_symbol.h>
 
 namespace pog {
@@ -16,15 +21,71 @@ class Automaton
 public:
 	using GrammarType = Grammar<ValueT>;
 	using ItemType = Item<ValueT>;
+	using RuleType = Rule<ValueT>;
 	using StateType = State<ValueT>;
 	using SymbolType = Symbol<ValueT>;
 
+	using StateAndRuleType = StateAndRule<ValueT>;
 	using StateAndSymbolType = StateAndSymbol<ValueT>;
 
-	Automaton(const GrammarType* grammar) : _grammar(grammar), _states(), _state_to_index() {}
+	Automaton(const GrammarType* grammar) : _grammar(grammar), _states(), _state_to_index(), _nonterminal_transitions(),
+		_transition_offsets(), _reductions(), _reduction_offsets(), _constructed_rules() {}
 
 	const std::vector<std::unique_ptr<StateType>>& get_states() const { return _states; }
 
+	/**
+	 * Transitions over nonterminals numbered densely from 0. Transitions of a single state
+	 * occupy a contiguous block of ids and are ordered by the index of their symbol.
+	 */
+	const std::vector<StateAndSymbolType>& get_nonterminal_transitions() const { return _nonterminal_transitions; }
+
+	/**
+	 * Pairs of state and rule such that the state contains final item of the rule, numbered densely from 0.
+	 * Reductions of a single state occupy a contiguous block of ids and are in the same order as final
+	 * items of the state.
+	 */
+	const std::vector<StateAndRuleType>& get_reductions() const { return _reductions; }
+
+	/**
+	 * Returns range of ids [first, last) of reductions which belong to the given state.
+	 */
+	std::pair<std::uint32_t, std::uint32_t> get_reduction_ids(const StateType* state) const
+	{
+		if (state->get_index() + 1 >= _reduction_offsets.size())
+			return {0, 0};
+
+		return {_reduction_offsets[state->get_index()], _reduction_offsets[state->get_index() + 1]};
+	}
+
+	std::optional<std::uint32_t> get_nonterminal_transition_id(const StateType* state, const SymbolType* symbol) const
+	{
+		if (state->get_index() + 1 >= _transition_offsets.size())
+			return std::nullopt;
+
+		auto begin = _nonterminal_transitions.begin() + _transition_offsets[state->get_index()];
+		auto end = _nonterminal_transitions.begin() + _transition_offsets[state->get_index() + 1];
+		auto itr = std::partition_point(begin, end, [&](const auto& ss) {
+			return ss.symbol->get_index() < symbol->get_index();
+		});
+		if (itr == end || itr->symbol != symbol)
+			return std::nullopt;
+
+		return static_cast<std::uint32_t>(itr - _nonterminal_transitions.begin());
+	}
+
+	std::optional<std::uint32_t> get_reduction_id(const StateType* state, const RuleType* rule) const
+	{
+		// There are usually just a few final items in the state so linear search is enough
+		auto [first, last] = get_reduction_ids(state);
+		for (auto id = first; id < last; ++id)
+		{
+			if (_reductions[id].rule == rule)
+				return id;
+		}
+
+		return std::nullopt;
+	}
+
 	const StateType* get_state(std::size_t index) const
 	{
 		assert(index < _states.size() && "Accessing state index out of bounds");
@@ -45,33 +106,87 @@ public:
 
 	void closure(StateType& state)
 	{
-		std::deque<const ItemType*> to_process;
+		// Closure only ever adds items A -> <*> a for all rules of nonterminal A, so it is
+		// enough to remember which nonterminals were already expanded. All new items are then
+		// added to the state at once.
+		Bitset expanded(_grammar->get_symbols().size());
+		std::vector<ItemType> new_items;
+		std::vector<const SymbolType*> to_process;
+
+		auto expand = [&](const ItemType& item) {
+			const auto* next_symbol = item.get_read_symbol();
+			if (next_symbol && next_symbol->is_nonterminal() && !expanded.test(next_symbol->get_index()))
+			{
+				expanded.set(next_symbol->get_index());
+				to_process.push_back(next_symbol);
+			}
+		};
+
 		for (const auto& item : state)
-			to_process.push_back(item.get());
+			expand(item);
 
 		while (!to_process.empty())
 		{
-			const auto* current_item = to_process.front();
-			to_process.pop_front();
+			const auto* symbol = to_process.back();
+			to_process.pop_back();
 
-			const auto* next_symbol = current_item->get_read_symbol();
-			auto rules = _grammar->get_rules_of_symbol(next_symbol);
-			for (const auto* rule : rules)
+			for (const auto* rule : _grammar->get_rules_of_symbol(symbol))
 			{
-				auto new_item = Item{rule};
-				auto result = state.add_item(std::move(new_item));
-				if (result.second)
-					to_process.push_back(result.first);
+				new_items.emplace_back(rule);
+				expand(new_items.back());
 			}
 		}
+
+		state.add_items(std::move(new_items));
 	}
 
 	void construct_states()
 	{
+		// States of the previous construction are kept aside so that we can reuse closures of the states
+		// which are not affected by the changes of the grammar since then
+		auto previous_states = std::move(_states);
+		auto previous_state_to_index = std::move(_state_to_index);
+		_states.clear();
+		_state_to_index.clear();
+
+		// Closures change only for nonterminals which have some new rules or whose rules were pruned, inlined or used again
+		const auto& rules = _grammar->get_rules();
+		Bitset changed_symbols(_grammar->get_symbols().size());
+		_constructed_rules.resize(rules.size(), false);
+		for (const auto& rule : rules)
+		{
+			bool used = !rule->is_pruned() && !rule->is_inlined();
+			if (_constructed_rules[rule->get_index()] != used)
+				changed_symbols.set(rule->get_lhs()->get_index());
+			_constructed_rules[rule->get_index()] = used;
+		}
+
+		auto complete_state = [&](StateType& state) {
+			// Closure of the state with the same kernel can be reused if it doesn't contain any item A -> a <*> B b
+			// where B has some new rules
+			if (auto itr = previous_state_to_index.find(&state); itr != previous_state_to_index.end())
+			{
+				const auto& previous_state = *previous_states[itr->second].get();
+				bool affected = std::any_of(previous_state.begin(), previous_state.end(), [&](const auto& item) {
+					const auto* next_symbol = item.get_read_symbol();
+					return next_symbol && changed_symbols.test(next_symbol->get_index());
+				});
+				if (!affected)
+				{
+					state.add_items(std::vector<ItemType>(previous_state.begin() + previous_state.get_kernel().size(), previous_state.end()));
+					return;
+				}
+			}
+
+			closure(state);
+		};
+
 		StateType initial_state;
 		initial_state.add_item(ItemType{_grammar->get_start_rule()});
+		for (const auto* start_rule : _grammar->get_additional_start_rules())
+			initial_state.add_item(ItemType{start_rule});
 		initial_state.set_index(0);
-		closure(initial_state);
+		complete_state(initial_state);
 		auto result = add_state(std::move(initial_state));
 
 		std::deque<StateType*> to_process{result.first};
@@ -83,14 +198,14 @@ public:
 			std::map<const SymbolType*, StateType, SymbolLess<ValueT>> prepared_states;
 			for (const auto& item : *state)
 			{
-				if (item->is_final())
+				if (item.is_final())
 					continue;
 
-				auto next_sym = item->get_read_symbol();
+				auto next_sym = item.get_read_symbol();
 				if (next_sym->is_end())
 					continue;
 
-				auto new_item = Item{*item};
+				auto new_item = Item{item};
 				new_item.step();
 
 				auto itr = prepared_states.find(next_sym);
@@ -109,13 +224,42 @@ public:
 					// We calculate closure only if it's new state introduced in the automaton.
 					// States can be compared only with their kernel items so it's better to just do it
 					// once for each state.
-					closure(*target_state);
+					complete_state(*target_state);
 					to_process.push_back(target_state);
 				}
 				state->add_transition(symbol, target_state);
 				target_state->add_back_transition(symbol, state);
 			}
 		}
+
+		number_transitions_and_reductions();
+	}
+
+	void number_transitions_and_reductions()
+	{
+		_nonterminal_transitions.clear();
+		_reductions.clear();
+		_transition_offsets.assign(1, 0);
+		_reduction_offsets.assign(1, 0);
+
+		for (const auto& state : _states)
+		{
+			// Transitions are stored in map ordered by symbol index so they come out already sorted
+			for (const auto& [symbol, dest_state] : state->get_transitions())
+			{
+				if (symbol->is_nonterminal())
+					_nonterminal_transitions.push_back(StateAndSymbolType{state.get(), symbol});
+			}
+
+			for (const auto& item : *state)
+			{
+				if (item.is_final())
+					_reductions.push_back(StateAndRuleType{state.get(), item.get_rule()});
+			}
+
+			_transition_offsets.push_back(static_cast<std::uint32_t>(_nonterminal_transitions.size()));
+			_reduction_offsets.push_back(static_cast<std::uint32_t>(_reductions.size()));
+		}
 	}
 
 	std::string generate_graph() const
@@ -124,7 +268,7 @@ public:
 		std::transform(_states.begin(), _states.end(), states_str.begin(), [](const auto& state) {
 			std::vector<std::string> items_str(state->size());
 			std::transform(state->begin(), state->end(), items_str.begin(), [](const auto& item) {
-				return item->to_string("→", "ε", "•");
+				return item.to_string("→", "ε", "•");
 			});
 			return fmt::format("{} [label=\"{}\\l\", xlabel=\"{}\"]", state->get_index(), fmt::join(items_str.begin(), items_str.end(), "\\l"), state->get_index());
 		});
@@ -152,6 +296,11 @@ private:
 	const GrammarType* _grammar;
 	std::vector<std::unique_ptr<StateType>> _states;
 	std::unordered_map<const StateType*, std::size_t, StateKernelHash<ValueT>, StateKernelEquals<ValueT>> _state_to_index;
+	std::vector<StateAndSymbolType> _nonterminal_transitions;
+	std::vector<std::uint32_t> _transition_offsets;
+	std::vector<StateAndRuleType> _reductions;
+	std::vector<std::uint32_t> _reduction_offsets;
+	std::vector<bool> _constructed_rules;
 };
 
 } // namespace pog
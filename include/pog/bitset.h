@@ -0,0 +1,210 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace pog {
+
+namespace detail {
+
+inline std::size_t count_trailing_zeros(std::uint64_t word)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, word);
+	return static_cast<std::size_t>(index);
+#else
+	return static_cast<std::size_t>(__builtin_ctzll(word));
+#endif
+}
+
+inline std::size_t popcount(std::uint64_t word)
+{
+#ifdef _MSC_VER
+	return static_cast<std::size_t>(__popcnt64(word));
+#else
+	return static_cast<std::size_t>(__builtin_popcountll(word));
+#endif
+}
+
+} // namespace detail
+
+/**
+ * Dynamically sized set of small non-negative integers represented as a dense bitset.
+ * It is used to represent sets of symbols (indexed by their symbol index) in LALR
+ * computations, where union of two sets is the most frequent operation. Union is
+ * performed word by word which compilers happily vectorize.
+ *
+ * Iteration yields indices of set bits in ascending order.
+ */
+class Bitset
+{
+public:
+	using WordType = std::uint64_t;
+	static constexpr std::size_t WordBits = 64;
+
+	class iterator
+	{
+	public:
+		using difference_type = std::ptrdiff_t;
+		using value_type = std::size_t;
+		using reference = std::size_t;
+		using pointer = const std::size_t*;
+		using iterator_category = std::forward_iterator_tag;
+
+		iterator(const Bitset* parent, std::size_t word_index) : _parent(parent), _word_index(word_index), _word(0)
+		{
+			if (_word_index < _parent->_words.size())
+				_word = _parent->_words[_word_index];
+			_find_next();
+		}
+
+		std::size_t operator*() const { return _word_index * WordBits + detail::count_trailing_zeros(_word); }
+
+		iterator& operator++()
+		{
+			// Clear the lowest set bit
+			_word &= _word - 1;
+			_find_next();
+			return *this;
+		}
+
+		iterator operator++(int)
+		{
+			auto tmp = *this;
+			++(*this);
+			return tmp;
+		}
+
+		bool operator==(const iterator& rhs) const { return _word_index == rhs._word_index && _word == rhs._word; }
+		bool operator!=(const iterator& rhs) const { return !(*this == rhs); }
+
+	private:
+		void _find_next()
+		{
+			while (_word == 0 && _word_index < _parent->_words.size())
+			{
+				if (++_word_index < _parent->_words.size())
+					_word = _parent->_words[_word_index];
+			}
+		}
+
+		const Bitset* _parent;
+		std::size_t _word_index;
+		WordType _word;
+	};
+
+	Bitset() : _words() {}
+	Bitset(std::size_t size) : _words(words_for(size), 0) {}
+	Bitset(const Bitset&) = default;
+	Bitset(Bitset&&) noexcept = default;
+
+	Bitset& operator=(const Bitset&) = default;
+	Bitset& operator=(Bitset&&) noexcept = default;
+
+	std::size_t size() const { return _words.size() * WordBits; }
+
+	bool empty() const
+	{
+		return std::all_of(_words.begin(), _words.end(), [](auto word) { return word == 0; });
+	}
+
+	std::size_t count() const
+	{
+		std::size_t result = 0;
+		for (auto word : _words)
+			result += detail::popcount(word);
+		return result;
+	}
+
+	bool test(std::size_t index) const
+	{
+		auto word_index = index / WordBits;
+		return word_index < _words.size() && (_words[word_index] & bit(index)) != 0;
+	}
+
+	void set(std::size_t index)
+	{
+		auto word_index = index / WordBits;
+		if (word_index >= _words.size())
+			_words.resize(word_index + 1, 0);
+		_words[word_index] |= bit(index);
+	}
+
+	void reset(std::size_t index)
+	{
+		auto word_index = index / WordBits;
+		if (word_index < _words.size())
+			_words[word_index] &= ~bit(index);
+	}
+
+	void clear()
+	{
+		std::fill(_words.begin(), _words.end(), 0);
+	}
+
+	/**
+	 * Performs union with another bitset and returns whether any new bit was set.
+	 */
+	bool merge(const Bitset& rhs)
+	{
+		if (_words.size() < rhs._words.size())
+			_words.resize(rhs._words.size(), 0);
+
+		WordType changed = 0;
+		for (std::size_t i = 0; i < rhs._words.size(); ++i)
+		{
+			auto old = _words[i];
+			_words[i] |= rhs._words[i];
+			changed |= old ^ _words[i];
+		}
+		return changed != 0;
+	}
+
+	Bitset& operator|=(const Bitset& rhs)
+	{
+		merge(rhs);
+		return *this;
+	}
+
+	/**
+	 * Returns whether every bit set in this bitset is also set in another bitset.
+	 */
+	bool is_subset_of(const Bitset& rhs) const
+	{
+		for (std::size_t i = 0; i < _words.size(); ++i)
+		{
+			auto rhs_word = i < rhs._words.size() ? rhs._words[i] : WordType{0};
+			if ((_words[i] & ~rhs_word) != 0)
+				return false;
+		}
+		return true;
+	}
+
+	iterator begin() const { return iterator{this, 0}; }
+	iterator end() const { return iterator{this, _words.size()}; }
+
+	bool operator==(const Bitset& rhs) const
+	{
+		const auto& shorter = _words.size() < rhs._words.size() ? _words : rhs._words;
+		const auto& longer = _words.size() < rhs._words.size() ? rhs._words : _words;
+		return std::equal(shorter.begin(), shorter.end(), longer.begin())
+			&& std::all_of(longer.begin() + shorter.size(), longer.end(), [](auto word) { return word == 0; });
+	}
+
+	bool operator!=(const Bitset& rhs) const { return !(*this == rhs); }
+
+private:
+	static std::size_t words_for(std::size_t size) { return (size + WordBits - 1) / WordBits; }
+	static WordType bit(std::size_t index) { return WordType{1} << (index % WordBits); }
+
+	std::vector<WordType> _words;
+};
+
+} // namespace pog
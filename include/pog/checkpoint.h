@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include <pog/tokenizer.h>
+#include <pog/value_handler.h>
+
+namespace pog {
+
+/**
+ * Snapshot of the parser in the middle of step by step parsing (see Parser::checkpoint()). It contains the stack
+ * of LR states, checkpoint of the value stack, token which was read but not shifted yet and the checkpoint of the tokenizer.
+ */
+template <typename ValueT>
+struct Checkpoint
+{
+	std::uint64_t session; ///< Checkpoint can be restored only in the same parsing it was created in
+	std::vector<std::uint32_t> stack;
+	typename ValueHandler<ValueT>::Checkpoint values;
+	std::optional<TokenMatch<ValueT>> token;
+	TokenizerCheckpoint<ValueT> tokenizer;
+	bool accepted;
+};
+
+} // namespace pog
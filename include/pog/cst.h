@@ -0,0 +1,210 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <pog/memory_resource.h>
+#include <pog/rule.h>
+#include <pog/symbol.h>
+#include <pog/tokenizer.h>
+
+namespace pog {
+
+/**
+ * Edit of the input which replaced removed bytes at the offset with inserted bytes.
+ */
+struct TextEdit
+{
+	std::size_t offset;
+	std::size_t removed;
+	std::size_t inserted;
+};
+
+template <typename ValueT>
+struct CstNode
+{
+	const Symbol<ValueT>* symbol;
+	const Rule<ValueT>* rule; ///< Rule which was reduced, nullptr for tokens
+	std::uint32_t child_count;
+	std::uint32_t subtree_size; ///< Number of nodes in the subtree of this node including the node itself
+	std::size_t offset; ///< Offset of the token (or first token of the subtree) in the input
+	std::size_t length; ///< Length of the input covered by the node
+	std::uint32_t state; ///< State of LR automaton which parser entered with this node on top of the stack
+	std::size_t lookahead; ///< Number of bytes after the token which tokenizer examined when reading it (or tokens skipped before it), 0 for rules
+
+	bool is_token() const { return rule == nullptr; }
+};
+
+/**
+ * Concrete syntax tree stored as a flat array of nodes in post-order, so every node comes right after all nodes of its subtree
+ * and the root is the last node. Building the tree costs only one append for each shift and reduction of the parser
+ * and passes over the tree which don't care about the order of siblings can just iterate over the array.
+ *
+ * Children of the node can be found going backwards from the node. The last child is right before its parent
+ * and each previous sibling is right before the subtree of the next one.
+ */
+template <typename ValueT>
+class Cst
+{
+public:
+	using NodeType = CstNode<ValueT>;
+	using RuleType = Rule<ValueT>;
+	using SymbolType = Symbol<ValueT>;
+
+	/**
+	 * Lightweight reference to the node of the tree which can be used to walk the tree.
+	 */
+	class Cursor
+	{
+	public:
+		Cursor(const Cst* cst, std::size_t index) : _cst(cst), _index(index) {}
+
+		std::size_t get_index() const { return _index; }
+		const NodeType& get_node() const { return (*_cst)[_index]; }
+		const NodeType& operator*() const { return get_node(); }
+		const NodeType* operator->() const { return &get_node(); }
+
+		std::vector<Cursor> children() const
+		{
+			std::vector<Cursor> result;
+			result.reserve(get_node().child_count);
+
+			auto child = _index;
+			for (std::uint32_t i = 0; i < get_node().child_count; ++i)
+			{
+				--child;
+				result.emplace_back(_cst, child);
+				child -= (*_cst)[child].subtree_size - 1;
+			}
+
+			std::reverse(result.begin(), result.end());
+			return result;
+		}
+
+		bool operator==(const Cursor& rhs) const { return _cst == rhs._cst && _index == rhs._index; }
+		bool operator!=(const Cursor& rhs) const { return !(*this == rhs); }
+
+	private:
+		const Cst* _cst;
+		std::size_t _index;
+	};
+
+	Cst(pmr::memory_resource* resource = pmr::get_default_resource()) : _nodes(resource), _tokenizer_states() {}
+
+	std::size_t size() const { return _nodes.size(); }
+	bool empty() const { return _nodes.empty(); }
+	const NodeType& operator[](std::size_t index) const { return _nodes[index]; }
+	const pmr::vector<NodeType>& get_nodes() const { return _nodes; }
+
+	Cursor root() const
+	{
+		assert(!empty() && "Root of empty tree requested");
+		return Cursor{this, _nodes.size() - 1};
+	}
+
+	/**
+	 * Calls the function with the cursor of each node of the tree in post-order.
+	 */
+	template <typename F>
+	void visit(F&& f) const
+	{
+		for (std::size_t i = 0; i < _nodes.size(); ++i)
+			f(Cursor{this, i});
+	}
+
+	void add_token(const SymbolType* symbol, std::size_t offset, std::size_t length, std::uint32_t state = 0, std::size_t lookahead = 0)
+	{
+		_nodes.push_back(NodeType{symbol, nullptr, 0, 1, offset, length, state, lookahead});
+	}
+
+	/**
+	 * Adds the node of the rule whose children are the last child_count subtrees in the tree.
+	 */
+	void add_reduction(const RuleType* rule, std::uint32_t child_count, std::uint32_t state = 0)
+	{
+		std::uint32_t subtree_size = 1;
+		for (std::uint32_t i = 0; i < child_count; ++i)
+		{
+			assert(_nodes.size() >= subtree_size && "Not enough subtrees for the reduction. This shouldn't happen");
+			subtree_size += _nodes[_nodes.size() - subtree_size].subtree_size;
+		}
+
+		// Empty subtree begins where the previous node ends
+		auto end = _nodes.empty() ? 0 : _nodes.back().offset + _nodes.back().length;
+		auto offset = child_count > 0 ? _nodes[_nodes.size() - subtree_size + 1].offset : end;
+		_nodes.push_back(NodeType{rule->get_lhs(), rule, child_count, subtree_size, offset, end - offset, state, 0});
+	}
+
+	/**
+	 * Records the state of the tokenizer in which it reads the tokens following the last node. States are recorded
+	 * only when they change.
+	 */
+	void set_tokenizer_state(std::string_view state)
+	{
+		if (get_tokenizer_state(_nodes.size() - 1) != state)
+			_tokenizer_states.emplace_back(_nodes.size() - 1, std::string{state});
+	}
+
+	/**
+	 * Returns the state of the tokenizer in which it reads the tokens following the given node.
+	 */
+	std::string_view get_tokenizer_state(std::size_t index) const
+	{
+		auto itr = std::upper_bound(_tokenizer_states.begin(), _tokenizer_states.end(), index, [](auto index, const auto& record) {
+			return index < record.first;
+		});
+		return itr == _tokenizer_states.begin() ? Tokenizer<ValueT>::DefaultState : std::string_view{std::prev(itr)->second};
+	}
+
+	/**
+	 * Returns the stack of LR states which parser had right after the first count nodes were added to the tree.
+	 * These are the states of the roots of the complete subtrees in those nodes.
+	 */
+	std::vector<std::uint32_t> get_stack(std::size_t count) const
+	{
+		std::vector<std::uint32_t> result;
+		for (auto index = count; index > 0; index -= _nodes[index - 1].subtree_size)
+			result.push_back(_nodes[index - 1].state);
+		result.push_back(0);
+
+		std::reverse(result.begin(), result.end());
+		return result;
+	}
+
+	/**
+	 * Appends nodes in range [begin, end) of other tree and moves them in the input by the given distance.
+	 * Nodes in the range can have their subtrees partially outside of the range, sizes of their subtrees and covered
+	 * input are recalculated with respect to the nodes already in this tree.
+	 */
+	void append(const Cst& other, std::size_t begin, std::size_t end, std::ptrdiff_t offset_delta)
+	{
+		auto record = std::lower_bound(other._tokenizer_states.begin(), other._tokenizer_states.end(), begin, [](const auto& record, auto index) {
+			return record.first < index;
+		});
+
+		for (auto i = begin; i < end; ++i)
+		{
+			const auto& node = other[i];
+			if (node.is_token())
+				add_token(node.symbol, static_cast<std::size_t>(static_cast<std::ptrdiff_t>(node.offset) + offset_delta), node.length, node.state, node.lookahead);
+			else
+				add_reduction(node.rule, node.child_count, node.state);
+
+			for (; record != other._tokenizer_states.end() && record->first == i; ++record)
+				set_tokenizer_state(record->second);
+		}
+	}
+
+private:
+	pmr::vector<NodeType> _nodes;
+	std::vector<std::pair<std::size_t, std::string>> _tokenizer_states;
+};
+
+} // namespace pog
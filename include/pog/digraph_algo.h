@@ -1,58 +1,95 @@
 #pragma once
 
-#include <deque>
-#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
 
 namespace pog {
 
 namespace detail {
 
-template <typename NodeT, typename R, typename BaseF, typename F>
-void digraph_traverse(const NodeT& x, std::deque<NodeT>& stack, std::unordered_map<NodeT, std::size_t>& depths, const R& rel, BaseF& base_f, F& f)
+struct DigraphFrame
 {
-	stack.push_back(x); // push x
-	std::size_t current_depth = stack.size(); // d <- depth of stack
-	depths.insert_or_assign(x, current_depth); // N[x] <- d
-	f.insert_or_assign(x, base_f[x]); // F(x) <- F'(x)
+	std::uint32_t node;
+	std::size_t depth;
+	std::size_t next_edge;
+};
 
-	auto rel_with = rel.find(x);
-	if (rel_with)
+} // namespace detail
+
+/**
+ * Performs single Traverse(x) step of the digraph algorithm (see digraph_algo()) starting in node
+ * start. Depths of nodes need to be kept between the calls and are initially 0 for every node.
+ * Once this function returns, all nodes reachable from start have their final value of F(x).
+ *
+ * Function on_enter(x) is called whenever node x is visited for the first time, which is the last
+ * moment when the base value F'(x) can be filled in.
+ */
+template <typename R, typename F, typename OnEnterF>
+void digraph_traverse(const R& rel, std::vector<F>& f, std::vector<std::size_t>& depths, std::uint32_t start, OnEnterF&& on_enter)
+{
+	constexpr auto Infinity = std::numeric_limits<std::size_t>::max();
+
+	if (depths[start] != 0)
+		return;
+
+	std::vector<std::uint32_t> stack;
+	std::vector<detail::DigraphFrame> frames;
+
+	auto enter = [&](std::uint32_t x) {
+		on_enter(x);
+		stack.push_back(x); // push x
+		depths[x] = stack.size(); // N[x] <- d where d is depth of stack
+		frames.push_back(detail::DigraphFrame{x, stack.size(), 0});
+	};
+
+	enter(start); // Traverse(x)
+	while (!frames.empty())
 	{
-		for (const auto& y : *rel_with) // for each y such that xRy
+		auto& frame = frames.back();
+		auto x = frame.node;
+		auto edges = rel[x];
+
+		if (frame.next_edge < edges.size()) // for each y such that xRy
 		{
-			auto include_itr = depths.find(y);
-			if (include_itr == depths.end()) // if N[y] == 0
-				digraph_traverse(y, stack, depths, rel, base_f, f); // recursive call Traverse(y)
-
-			include_itr = depths.find(y); // possible iterator invalidation
-			include_itr->second = std::min(depths[x], include_itr->second); // N[y] <- min(N[x], N[y])
-			auto& fx = f[x];
-			auto& fy = f[y];
-			std::copy(fy.begin(), fy.end(), std::inserter(fx, fx.begin())); // F(x) <- F(x) union F(y)
+			auto y = edges[frame.next_edge++];
+			if (depths[y] == 0) // if N[y] == 0
+			{
+				enter(y); // Traverse(y)
+				continue;
+			}
+
+			depths[x] = std::min(depths[x], depths[y]); // N[x] <- min(N[x], N[y])
+			f[x] |= f[y]; // F(x) <- F(x) union F(y)
+			continue;
 		}
-	}
 
-	if (depths[x] == current_depth) // if N[x] == d
-	{
-		auto top_x = std::move(stack.back());
-		stack.pop_back();
-		depths[top_x] = std::numeric_limits<std::size_t>::max(); // N(top of stack) <- Infinity
-		if (top_x != x)
-			f[top_x] = f[x]; // F(top of stack) <- F(x)
+		if (depths[x] == frame.depth) // if N[x] == d
+		{
+			std::uint32_t top_x;
+			do // while top of stack != x
+			{
+				top_x = stack.back();
+				stack.pop_back();
+				depths[top_x] = Infinity; // N(top of stack) <- Infinity
+				if (top_x != x)
+					f[top_x] = f[x]; // F(top of stack) <- F(x)
+			} while (top_x != x);
+		}
 
-		while (top_x != x) // while top of stack != x
+		frames.pop_back();
+
+		// Finish the step of the caller which has just returned from Traverse(x)
+		if (!frames.empty())
 		{
-			top_x = std::move(stack.back());
-			stack.pop_back();
-			depths[top_x] = std::numeric_limits<std::size_t>::max(); // N(top of stack) <- Infinity
-			if (top_x != x)
-				f[top_x] = f[x]; // F(top of stack) <- F(x)
+			auto caller = frames.back().node;
+			depths[caller] = std::min(depths[caller], depths[x]); // N[x] <- min(N[x], N[y])
+			f[caller] |= f[x]; // F(x) <- F(x) union F(y)
 		}
 	}
 }
 
-} // namespace detail
-
 /**
  * Digraph algorithm for finding SCCs (Strongly Connected Components). It is used for
  * computation of function F(x) using base function F'(x) over directed graph. It first
@@ -60,21 +97,21 @@ void digraph_traverse(const NodeT& x, std::deque<NodeT>& stack, std::unordered_m
  * of directed graph. Finding SCC is a crucial part to not get into infinite loops and properly
  * propagate F(x) in looped relations.
  *
- * You can specify custom relation R which specifies edges of the directed graph, base function
- * F'(x) which needs to be already precomunted. The output is operation F(x) which will
- * be computed along the way.
+ * Nodes of the graph are numbered densely from 0. You can specify custom relation R which
+ * specifies edges of the directed graph, R[x] needs to provide range of nodes y such that xRy.
+ * Function F needs to be a vector indexed by nodes which already contains values of base
+ * function F'(x) and it is turned into F(x) along the way. Values of F need to support
+ * union through operator |=.
  *
- * TODO: base_f should not be non-const but we require operator[] right now
+ * The traversal is iterative, so its stack usage doesn't depend on the length of the paths
+ * in the relation.
  */
-template <typename NodeT, typename R, typename BaseF, typename F>
-void digraph_algo(const R& rel, BaseF& base_f, F& f)
+template <typename R, typename F>
+void digraph_algo(const R& rel, std::vector<F>& f)
 {
-	std::unordered_map<NodeT, std::size_t> depths;
-	std::deque<NodeT> stack;
-	for (const auto& x : rel)
-	{
-		detail::digraph_traverse(x.first, stack, depths, rel, base_f, f);
-	}
+	std::vector<std::size_t> depths(f.size(), 0);
+	for (std::uint32_t start = 0; start < rel.size(); ++start)
+		digraph_traverse(rel, f, depths, start, [](std::uint32_t) {});
 }
 
 } // namespace pog
@@ -1,12 +1,18 @@
 #pragma once
 
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <map>
 #include <memory>
+#include <optional>
 #include <unordered_set>
 #include <vector>
 
 #include <pog/rule.h>
 #include <pog/symbol.h>
 #include <pog/token.h>
+#include <pog/types/rule_and_position.h>
 #include <pog/utils.h>
 
 namespace pog {
@@ -19,8 +25,19 @@ public:
 	using SymbolType = Symbol<ValueT>;
 	using TokenType = Token<ValueT>;
 
+	using RuleAndPositionType = RuleAndPosition<ValueT>;
+
+	struct PruneResult
+	{
+		std::vector<const SymbolType*> symbols;
+		std::vector<const RuleType*> rules;
+	};
+
+	using RuleRange = IteratorRange<typename std::vector<const RuleType*>::const_iterator>;
+	using RuleAndPositionRange = IteratorRange<typename std::vector<RuleAndPositionType>::const_iterator>;
+
 	Grammar() : _rules(), _symbols(), _name_to_symbol(), _internal_start_symbol(nullptr), _internal_end_of_input(nullptr),
-			_start_rule(nullptr), _empty_table(), _first_table(), _follow_table()
+			_start_rule(nullptr), _additional_start_rules(), _empty_table(), _first_table(), _follow_table(), _index(), _expansions(), _expanded_rules()
 	{
 		_internal_start_symbol = add_symbol(SymbolKind::Nonterminal, "@start");
 		_internal_end_of_input = add_symbol(SymbolKind::End, "@end");
@@ -31,6 +48,7 @@ public:
 
 	const SymbolType* get_end_of_input_symbol() const { return _internal_end_of_input; }
 	const RuleType* get_start_rule() const { return _start_rule; }
+	const std::vector<const RuleType*>& get_additional_start_rules() const { return _additional_start_rules; }
 
 	std::vector<const SymbolType*> get_terminal_symbols() const
 	{
@@ -61,28 +79,42 @@ public:
 		return itr->second;
 	}
 
-	// TODO: return filter_view<>
-	std::vector<const RuleType*> get_rules_of_symbol(const SymbolType* sym) const
+	/**
+	 * Returns rules which have the given symbol on their left-hand side.
+	 */
+	RuleRange get_rules_of_symbol(const SymbolType* sym) const
 	{
-		std::vector<const RuleType*> result;
-		transform_if(_rules.begin(), _rules.end(), std::back_inserter(result), [&](const auto& rule) {
-			return sym == rule->get_lhs();
-		}, [](const auto& rule) {
-			return rule.get();
-		});
-		return result;
+		if (!sym)
+			return {};
+
+		const auto& index = get_index();
+		return index.rules_of_symbol.get(sym->get_index());
 	}
 
-	// TODO: return filter_view<>
-	std::vector<const RuleType*> get_rules_with_symbol(const SymbolType* sym) const
+	/**
+	 * Returns rules which contain the given symbol on their right-hand side. Each rule is
+	 * returned only once even if the symbol occurs multiple times in it.
+	 */
+	RuleRange get_rules_with_symbol(const SymbolType* sym) const
 	{
-		std::vector<const RuleType*> result;
-		transform_if(_rules.begin(), _rules.end(), std::back_inserter(result), [&](const auto& rule) {
-			return std::find(rule->get_rhs().begin(), rule->get_rhs().end(), sym) != rule->get_rhs().end();
-		}, [](const auto& rule) {
-			return rule.get();
-		});
-		return result;
+		if (!sym)
+			return {};
+
+		const auto& index = get_index();
+		return index.rules_with_symbol.get(sym->get_index());
+	}
+
+	/**
+	 * Returns all occurrences of the given symbol on right-hand sides of rules
+	 * as pairs of rule and position in its right-hand side.
+	 */
+	RuleAndPositionRange get_symbol_occurrences(const SymbolType* sym) const
+	{
+		if (!sym)
+			return {};
+
+		const auto& index = get_index();
+		return index.occurrences.get(sym->get_index());
 	}
 
 	void set_start_symbol(const SymbolType* symbol)
@@ -94,6 +126,40 @@ public:
 		_start_rule = start_rule;
 	}
 
+	/**
+	 * Adds another start symbol besides the one set by set_start_symbol(). Each additional start symbol S gets its own start rule
+	 * @start -> @start:S S @end where @start:S is internal terminal (start marker) which is never read from the input. Parser
+	 * passes it as the very first token to select the start symbol. All start symbols therefore share single LR automaton
+	 * with single initial state.
+	 */
+	void add_start_symbol(const SymbolType* symbol)
+	{
+		if (get_start_marker(symbol))
+			return;
+
+		auto* marker = add_symbol(SymbolKind::Terminal, "@start:" + symbol->get_name());
+		marker->set_start_marker(true);
+		auto start_rule = add_rule(_internal_start_symbol, std::vector<const SymbolType*>{marker, symbol, _internal_end_of_input}, [](auto&& args) {
+			return std::move(args[1]);
+		});
+		start_rule->set_start_rule(true);
+		_additional_start_rules.push_back(start_rule);
+	}
+
+	/**
+	 * Returns start marker of the additional start symbol or nullptr if the symbol isn't additional start symbol.
+	 */
+	const SymbolType* get_start_marker(const SymbolType* symbol) const
+	{
+		for (const auto* rule : _additional_start_rules)
+		{
+			if (rule->get_rhs()[1] == symbol)
+				return rule->get_rhs()[0];
+		}
+
+		return nullptr;
+	}
+
 	SymbolType* add_symbol(SymbolKind kind, const std::string& name)
 	{
 		if (auto itr = _name_to_symbol.find(name); itr != _name_to_symbol.end())
@@ -101,6 +167,7 @@ public:
 
 		_symbols.push_back(std::make_unique<SymbolType>(static_cast<std::uint32_t>(_symbols.size()), kind, name));
 		_name_to_symbol.emplace(_symbols.back()->get_name(), _symbols.back().get());
+		_index.reset();
 		return _symbols.back().get();
 	}
 
@@ -108,9 +175,355 @@ public:
 	RuleType* add_rule(const SymbolType* lhs, const std::vector<const SymbolType*>& rhs, CallbackT&& action)
 	{
 		_rules.push_back(std::make_unique<RuleType>(static_cast<std::uint32_t>(_rules.size()), lhs, rhs, std::forward<CallbackT>(action)));
+		_index.reset();
+		// New rule can change results of Empty(), First() and Follow() of any symbol
+		_empty_table.clear();
+		_first_table.clear();
+		_follow_table.clear();
 		return _rules.back().get();
 	}
 
+	/**
+	 * Replaces occurrences of inlined nonterminals on right-hand sides of rules with right-hand sides of their rules.
+	 * Rule A -> a B c where B is inlined and has rules B -> x and B -> y is replaced with rules A -> a x c and A -> a y c.
+	 * Action of the new rule performs action of the rule of B over values of x (or y) and then action of the original rule.
+	 * If the original rule has no precedence, the new rule takes precedence of the rule of B. Replaced rules and rules
+	 * of B are kept in the grammar but they are excluded from the index of rules. Rules of B are used as they are only if
+	 * B still occurs in some rule which couldn't be expanded.
+	 *
+	 * Nonterminals which can reach themselves through other inlined nonterminals or which have rules with midrule actions
+	 * are never inlined. Start rule, accumulating rules and rules with midrule actions are never expanded. Inlining is always performed over all
+	 * rules and rules created by previous inlining are reused if they are still needed.
+	 */
+	void inline_symbols()
+	{
+		// Start over from the original rules, rules created by previous inlining are used again only if they are needed
+		std::vector<std::vector<const RuleType*>> original_rules(_symbols.size());
+		std::vector<bool> midrule_symbols(_symbols.size(), false);
+		for (auto& rule : _rules)
+		{
+			bool expanded = _expanded_rules.find(rule.get()) != _expanded_rules.end();
+			rule->set_inlined(expanded);
+			if (!expanded)
+				original_rules[rule->get_lhs()->get_index()].push_back(rule.get());
+			if (rule->is_midrule())
+				midrule_symbols[rule->get_lhs()->get_index()] = true;
+		}
+
+		auto has_midrule_symbol = [&](const RuleType* rule) {
+			return std::any_of(rule->get_rhs().begin(), rule->get_rhs().end(), [&](const auto* symbol) {
+				return midrule_symbols[symbol->get_index()];
+			});
+		};
+
+		std::vector<bool> inlinable(_symbols.size(), false);
+		for (const auto& symbol : _symbols)
+		{
+			const auto& rules = original_rules[symbol->get_index()];
+			inlinable[symbol->get_index()] = symbol->is_inlined() && symbol->is_nonterminal() && !rules.empty()
+				&& std::none_of(rules.begin(), rules.end(), [&](const auto* rule) {
+					return rule->is_midrule() || rule->is_accumulating() || rule->has_sink() || has_midrule_symbol(rule);
+				});
+		}
+
+		// Nonterminals on cycles of inlined nonterminals can't be inlined because their expansion would never end.
+		// Every cycle has at least one back edge in DFS so we mark all nonterminals on the stack which are part of it.
+		std::vector<bool> recursive(_symbols.size(), false);
+		std::vector<std::uint8_t> visited(_symbols.size(), 0);
+		std::vector<const SymbolType*> stack;
+		std::function<void(const SymbolType*)> find_recursion = [&](const SymbolType* symbol) {
+			visited[symbol->get_index()] = 1;
+			stack.push_back(symbol);
+			for (const auto* rule : original_rules[symbol->get_index()])
+			{
+				for (const auto* rhs_symbol : rule->get_rhs())
+				{
+					if (!inlinable[rhs_symbol->get_index()])
+						continue;
+
+					if (visited[rhs_symbol->get_index()] == 0)
+						find_recursion(rhs_symbol);
+					else if (visited[rhs_symbol->get_index()] == 1)
+					{
+						auto cycle_begin = std::find(stack.begin(), stack.end(), rhs_symbol);
+						std::for_each(cycle_begin, stack.end(), [&](const auto* cycle_symbol) {
+							recursive[cycle_symbol->get_index()] = true;
+						});
+					}
+				}
+			}
+			stack.pop_back();
+			visited[symbol->get_index()] = 2;
+		};
+
+		for (const auto& symbol : _symbols)
+		{
+			if (inlinable[symbol->get_index()] && visited[symbol->get_index()] == 0)
+				find_recursion(symbol.get());
+		}
+
+		for (std::size_t i = 0; i < inlinable.size(); ++i)
+			inlinable[i] = inlinable[i] && !recursive[i];
+
+		// Each expansion of the rule is identified by the index of the rule followed by keys of expansions chosen
+		// for its inlined nonterminals
+		struct Expansion
+		{
+			std::vector<const SymbolType*> rhs;
+			std::vector<std::uint32_t> key;
+			std::vector<InlinedPart> parts;
+			std::optional<Precedence> precedence;
+			typename RuleType::CallbackType action;
+			std::vector<bool> used; ///< Whether the value of each symbol of rhs is used by the action
+		};
+
+		std::vector<std::optional<std::vector<Expansion>>> symbol_expansions(_symbols.size());
+		std::function<std::vector<Expansion>(const RuleType*)> expand = [&](const RuleType* rule) {
+			std::vector<Expansion> result{Expansion{
+				{},
+				{rule->get_index()},
+				{},
+				rule->has_precedence() ? std::optional<Precedence>{rule->get_precedence()} : std::nullopt,
+				{},
+				{}
+			}};
+
+			for (std::size_t i = 0; i < rule->get_rhs().size(); ++i)
+			{
+				const auto* symbol = rule->get_rhs()[i];
+				if (!inlinable[symbol->get_index()])
+				{
+					for (auto& expansion : result)
+					{
+						expansion.rhs.push_back(symbol);
+						expansion.parts.push_back(InlinedPart{1, {}, false});
+						expansion.used.push_back(rule->is_argument_used(i));
+					}
+					continue;
+				}
+
+				auto& inner_expansions = symbol_expansions[symbol->get_index()];
+				if (!inner_expansions)
+				{
+					inner_expansions = std::vector<Expansion>{};
+					for (const auto* inner_rule : original_rules[symbol->get_index()])
+					{
+						auto tmp = expand(inner_rule);
+						std::move(tmp.begin(), tmp.end(), std::back_inserter(inner_expansions.value()));
+					}
+				}
+
+				std::vector<Expansion> new_result;
+				for (const auto& expansion : result)
+				{
+					for (const auto& inner_expansion : inner_expansions.value())
+					{
+						auto new_expansion = expansion;
+						std::copy(inner_expansion.rhs.begin(), inner_expansion.rhs.end(), std::back_inserter(new_expansion.rhs));
+						std::copy(inner_expansion.key.begin(), inner_expansion.key.end(), std::back_inserter(new_expansion.key));
+						new_expansion.parts.push_back(InlinedPart{inner_expansion.rhs.size(), inner_expansion.action, true});
+						// Values of inlined symbols are passed to the action of the inlined rule, which has default value without action
+						std::transform(inner_expansion.used.begin(), inner_expansion.used.end(), std::back_inserter(new_expansion.used), [&](auto used) {
+							return used && static_cast<bool>(inner_expansion.action);
+						});
+						if (!new_expansion.precedence)
+							new_expansion.precedence = inner_expansion.precedence;
+						new_result.push_back(std::move(new_expansion));
+					}
+				}
+				result = std::move(new_result);
+			}
+
+			for (auto& expansion : result)
+				expansion.action = compose_inlined_action(rule->get_action(), expansion.parts);
+			return result;
+		};
+
+		// Rules are added to the grammar during inlining so we can't iterate directly over them
+		for (std::size_t i = 0, rules_count = _rules.size(); i < rules_count; ++i)
+		{
+			auto* rule = _rules[i].get();
+			if (rule->is_inlined() || rule->is_start_rule() || rule->is_accumulating() || has_midrule_symbol(rule))
+				continue;
+
+			const auto& rhs = rule->get_rhs();
+			if (std::none_of(rhs.begin(), rhs.end(), [&](const auto* symbol) { return inlinable[symbol->get_index()]; }))
+				continue;
+
+			rule->set_inlined(true);
+			for (auto& expansion : expand(rule))
+			{
+				auto itr = _expansions.find(expansion.key);
+				if (itr == _expansions.end())
+				{
+					auto new_rule = add_rule(rule->get_lhs(), expansion.rhs, std::move(expansion.action));
+					if (expansion.precedence)
+						new_rule->set_precedence(expansion.precedence.value().level, expansion.precedence.value().assoc);
+					if (rule->has_sink())
+						new_rule->set_sink(rule->get_sink());
+					if (std::find(expansion.used.begin(), expansion.used.end(), false) != expansion.used.end())
+					{
+						std::vector<std::size_t> used_arguments;
+						for (std::size_t j = 0; j < expansion.used.size(); ++j)
+						{
+							if (expansion.used[j])
+								used_arguments.push_back(j);
+						}
+						new_rule->set_used_arguments(used_arguments);
+					}
+					_expanded_rules.insert(new_rule);
+					itr = _expansions.emplace(std::move(expansion.key), new_rule).first;
+				}
+
+				itr->second->set_inlined(false);
+			}
+		}
+
+		// Rules of inlined nonterminals are still needed if they occur in some rule which couldn't be expanded
+		std::vector<bool> referenced(_symbols.size(), false);
+		for (const auto& rule : _rules)
+		{
+			if (!rule->is_inlined() && !inlinable[rule->get_lhs()->get_index()])
+			{
+				for (const auto* symbol : rule->get_rhs())
+					referenced[symbol->get_index()] = true;
+			}
+		}
+
+		for (auto& rule : _rules)
+		{
+			if (inlinable[rule->get_lhs()->get_index()] && !referenced[rule->get_lhs()->get_index()])
+				rule->set_inlined(true);
+		}
+
+		_index.reset();
+		_empty_table.clear();
+		_first_table.clear();
+		_follow_table.clear();
+	}
+
+	/**
+	 * Prunes rules which can't be used in any derivation of a sentence from the start symbol. These are
+	 * rules which contain unproductive nonterminals (nonterminals which can't derive any string of terminals)
+	 * and rules of nonterminals which are unreachable from the start symbol. Pruned rules are kept in the grammar
+	 * but they are excluded from the index of rules, so they are never used in construction of the parser.
+	 * Start rule is never pruned.
+	 *
+	 * Pruning is always performed over all rules so rules pruned previously can be used again if they became useful.
+	 */
+	PruneResult prune()
+	{
+		PruneResult result;
+		if (!_start_rule)
+			return result;
+
+		for (auto& rule : _rules)
+			rule->set_pruned(false);
+		_index.reset();
+
+		// Nonterminal is productive if it has at least one rule with only productive symbols on its right-hand side.
+		// For each rule, we keep the number of occurrences of symbols we don't know yet to be productive. Once it drops
+		// to 0, left-hand side of the rule is productive too.
+		std::vector<bool> productive(_symbols.size(), false);
+		std::vector<std::size_t> unknown_count(_rules.size(), 0);
+		std::vector<const SymbolType*> to_process;
+		for (const auto& symbol : _symbols)
+		{
+			if (!symbol->is_nonterminal())
+			{
+				productive[symbol->get_index()] = true;
+				to_process.push_back(symbol.get());
+			}
+		}
+
+		for (const auto& rule : _rules)
+		{
+			if (rule->is_inlined())
+				continue;
+
+			unknown_count[rule->get_index()] = rule->get_rhs().size();
+			if (rule->get_rhs().empty() && !productive[rule->get_lhs()->get_index()])
+			{
+				productive[rule->get_lhs()->get_index()] = true;
+				to_process.push_back(rule->get_lhs());
+			}
+		}
+
+		while (!to_process.empty())
+		{
+			const auto* symbol = to_process.back();
+			to_process.pop_back();
+
+			for (const auto& [rule, position] : get_symbol_occurrences(symbol))
+			{
+				static_cast<void>(position);
+				if (--unknown_count[rule->get_index()] == 0 && !productive[rule->get_lhs()->get_index()])
+				{
+					productive[rule->get_lhs()->get_index()] = true;
+					to_process.push_back(rule->get_lhs());
+				}
+			}
+		}
+
+		// Only rules with all symbols productive can be used. We'll now look for symbols reachable from
+		// the start symbol using only those rules.
+		auto is_useful_rule = [&](const RuleType* rule) {
+			return rule->is_start_rule() || unknown_count[rule->get_index()] == 0;
+		};
+
+		std::vector<bool> reachable(_symbols.size(), false);
+		reachable[_internal_start_symbol->get_index()] = true;
+		to_process.push_back(_internal_start_symbol);
+		while (!to_process.empty())
+		{
+			const auto* symbol = to_process.back();
+			to_process.pop_back();
+
+			for (const auto* rule : get_rules_of_symbol(symbol))
+			{
+				if (!is_useful_rule(rule))
+					continue;
+
+				for (const auto* rhs_symbol : rule->get_rhs())
+				{
+					if (!reachable[rhs_symbol->get_index()])
+					{
+						reachable[rhs_symbol->get_index()] = true;
+						to_process.push_back(rhs_symbol);
+					}
+				}
+			}
+		}
+
+		for (auto& rule : _rules)
+		{
+			if (rule->is_inlined())
+				continue;
+
+			if (!is_useful_rule(rule.get()) || !reachable[rule->get_lhs()->get_index()])
+			{
+				rule->set_pruned(true);
+				result.rules.push_back(rule.get());
+			}
+		}
+
+		for (const auto& symbol : _symbols)
+		{
+			// Symbols which were inlined everywhere are not used anymore but that's expected
+			if (symbol->is_inlined() && get_rules_of_symbol(symbol.get()).empty())
+				continue;
+
+			if (!productive[symbol->get_index()] || !reachable[symbol->get_index()])
+				result.symbols.push_back(symbol.get());
+		}
+
+		_index.reset();
+		_empty_table.clear();
+		_first_table.clear();
+		_follow_table.clear();
+		return result;
+	}
+
 	bool empty(const SymbolType* sym) const
 	{
 		std::unordered_set<const SymbolType*> visited_lhss;
@@ -239,32 +652,25 @@ public:
 			return result;
 
 		visited.insert(sym);
-		auto rules = get_rules_with_symbol(sym);
-		for (const auto* rule : rules)
+		for (const auto& [rule, position] : get_symbol_occurrences(sym))
 		{
-			for (auto itr = rule->get_rhs().begin(), end = rule->get_rhs().end(); itr != end; ++itr)
+			bool can_be_last_in_production = true;
+			// If we have a production A -> a B b and we are doing Follow(B), we need to inspect everything
+			// right of B (so in this case 'b') whether there exist production b =>* eps.
+			// If so, B can be last in production and and therefore we need to add Follow(A) to Follow(B)
+			if (position + 1 != rule->get_rhs().size())
 			{
-				if (*itr == sym)
-				{
-					bool can_be_last_in_production = true;
-					// If we have a production A -> a B b and we are doing Follow(B), we need to inspect everything
-					// right of B (so in this case 'b') whether there exist production b =>* eps.
-					// If so, B can be last in production and and therefore we need to add Follow(A) to Follow(B)
-					if (itr + 1 != end)
-					{
-						std::vector<const SymbolType*> tail(itr + 1, end);
-						auto tmp = first(tail);
-						std::copy(tmp.begin(), tmp.end(), std::inserter(result, result.begin()));
-						can_be_last_in_production = empty(tail);
-					}
+				std::vector<const SymbolType*> tail(rule->get_rhs().begin() + position + 1, rule->get_rhs().end());
+				auto tmp = first(tail);
+				std::copy(tmp.begin(), tmp.end(), std::inserter(result, result.begin()));
+				can_be_last_in_production = empty(tail);
+			}
 
-					// There exists production b =>* eps so add Follow(A) to Follow(B)
-					if (can_be_last_in_production)
-					{
-						auto tmp = follow(rule->get_lhs(), visited);
-						std::copy(tmp.begin(), tmp.end(), std::inserter(result, result.begin()));
-					}
-				}
+			// There exists production b =>* eps so add Follow(A) to Follow(B)
+			if (can_be_last_in_production)
+			{
+				auto tmp = follow(rule->get_lhs(), visited);
+				std::copy(tmp.begin(), tmp.end(), std::inserter(result, result.begin()));
 			}
 		}
 
@@ -272,16 +678,142 @@ public:
 	}
 
 private:
+	/**
+	 * Part of the right-hand side of the rule created by inlining. It is either a single symbol of the original
+	 * rule or right-hand side of the inlined rule which spans over the given number of symbols.
+	 */
+	struct InlinedPart
+	{
+		std::size_t width;
+		typename RuleType::CallbackType action;
+		bool inlined;
+	};
+
+	/**
+	 * Creates action of the rule created by inlining. Values of the inlined parts are first passed to the actions
+	 * of the inlined rules and their results are then passed together with the rest of the values to the original action.
+	 */
+	static typename RuleType::CallbackType compose_inlined_action(const typename RuleType::CallbackType& action, const std::vector<InlinedPart>& parts)
+	{
+		bool any_inlined = std::any_of(parts.begin(), parts.end(), [](const auto& part) { return part.inlined; });
+		bool any_action = static_cast<bool>(action) || std::any_of(parts.begin(), parts.end(), [](const auto& part) {
+			return static_cast<bool>(part.action);
+		});
+		if (!any_inlined || !any_action)
+			return action;
+
+		return [action, parts](std::vector<ValueT>&& args) -> ValueT {
+			std::vector<ValueT> action_args;
+			action_args.reserve(parts.size());
+
+			auto itr = args.begin();
+			for (const auto& part : parts)
+			{
+				if (!part.inlined)
+				{
+					action_args.push_back(std::move(*itr++));
+					continue;
+				}
+
+				// Inlined rules without action would have default value
+				std::vector<ValueT> inlined_args(std::make_move_iterator(itr), std::make_move_iterator(itr + part.width));
+				itr += part.width;
+				action_args.push_back(part.action ? part.action(std::move(inlined_args)) : ValueT{});
+			}
+
+			return action ? action(std::move(action_args)) : ValueT{};
+		};
+	}
+
+	/**
+	 * Mapping of symbol index to the list of values stored in CSR (compressed sparse row) format.
+	 * Values of symbol with index i are stored in range [offsets[i], offsets[i + 1]) of values.
+	 */
+	template <typename T>
+	struct SymbolMapping
+	{
+		IteratorRange<typename std::vector<T>::const_iterator> get(std::size_t symbol_index) const
+		{
+			return {values.begin() + offsets[symbol_index], values.begin() + offsets[symbol_index + 1]};
+		}
+
+		template <typename F>
+		void build(std::size_t symbols_count, const std::vector<std::unique_ptr<RuleType>>& rules, F&& for_each_value)
+		{
+			// Count values for each symbol first and then place them into their slots.
+			// Pruned and inlined rules are not part of the index at all.
+			offsets.assign(symbols_count + 1, 0);
+			for (const auto& rule : rules)
+			{
+				if (!rule->is_pruned() && !rule->is_inlined())
+					for_each_value(rule.get(), [&](std::size_t symbol_index, auto&&) { offsets[symbol_index + 1]++; });
+			}
+
+			for (std::size_t i = 1; i < offsets.size(); ++i)
+				offsets[i] += offsets[i - 1];
+
+			values.resize(offsets.back());
+			auto positions = offsets;
+			for (const auto& rule : rules)
+			{
+				if (!rule->is_pruned() && !rule->is_inlined())
+					for_each_value(rule.get(), [&](std::size_t symbol_index, auto&& value) { values[positions[symbol_index]++] = std::forward<decltype(value)>(value); });
+			}
+		}
+
+		std::vector<std::size_t> offsets;
+		std::vector<T> values;
+	};
+
+	struct Index
+	{
+		SymbolMapping<const RuleType*> rules_of_symbol;
+		SymbolMapping<const RuleType*> rules_with_symbol;
+		SymbolMapping<RuleAndPositionType> occurrences;
+	};
+
+	const Index& get_index() const
+	{
+		// Index is built lazily and thrown away whenever new rule or symbol is added so it's always
+		// built only once for the final set of rules.
+		if (_index)
+			return *_index.get();
+
+		_index = std::make_unique<Index>();
+		_index->rules_of_symbol.build(_symbols.size(), _rules, [](const RuleType* rule, auto&& add) {
+			add(rule->get_lhs()->get_index(), rule);
+		});
+		_index->rules_with_symbol.build(_symbols.size(), _rules, [](const RuleType* rule, auto&& add) {
+			const auto& rhs = rule->get_rhs();
+			for (auto itr = rhs.begin(), end = rhs.end(); itr != end; ++itr)
+			{
+				if (std::find(rhs.begin(), itr, *itr) == itr)
+					add((*itr)->get_index(), rule);
+			}
+		});
+		_index->occurrences.build(_symbols.size(), _rules, [](const RuleType* rule, auto&& add) {
+			const auto& rhs = rule->get_rhs();
+			for (std::size_t i = 0; i < rhs.size(); ++i)
+				add(rhs[i]->get_index(), RuleAndPositionType{rule, i});
+		});
+		return *_index.get();
+	}
+
 	std::vector<std::unique_ptr<RuleType>> _rules;
 	std::vector<std::unique_ptr<SymbolType>> _symbols;
 	std::unordered_map<std::string, SymbolType*> _name_to_symbol;
 	const SymbolType* _internal_start_symbol;
 	const SymbolType* _internal_end_of_input;
 	const RuleType* _start_rule;
+	std::vector<const RuleType*> _additional_start_rules;
 
 	mutable std::unordered_map<const SymbolType*, bool> _empty_table;
 	mutable std::unordered_map<const SymbolType*, std::unordered_set<const SymbolType*>> _first_table;
 	mutable std::unordered_map<const SymbolType*, std::unordered_set<const SymbolType*>> _follow_table;
+	mutable std::unique_ptr<Index> _index;
+
+	std::map<std::vector<std::uint32_t>, RuleType*> _expansions;
+	std::unordered_set<const RuleType*> _expanded_rules;
 };
 
 } // namespace pog
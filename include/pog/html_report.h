@@ -178,8 +178,8 @@ private:
 
 				row.push_back(fmt::format(
 					"<td data-toggle=\"tooltip\" data-placement=\"bottom\" title=\"{state_str}\" data-html=\"true\"><a href=\"#state{state_id}\">{state_id}</a></td>",
-					"state_str"_a = go_to.value()->to_string("→", "ε", "•", "<br/>"),
-					"state_id"_a = go_to.value()->get_index()
+					"state_str"_a = go_to.value().state->to_string("→", "ε", "•", "<br/>"),
+					"state_id"_a = go_to.value().state->get_index()
 				));
 			}
 
@@ -237,7 +237,7 @@ private:
 		{
 			std::vector<std::string> cols(state->size());
 			std::transform(state->begin(), state->end(), cols.begin(), [](const auto& item) {
-				return fmt::format("<tr><td>{}</td></tr>", item->to_string("→", "ε", "•"));
+				return fmt::format("<tr><td>{}</td></tr>", item.to_string("→", "ε", "•"));
 			});
 			states.push_back(fmt::format(
 				single_state_template,
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace pog {
+
+/**
+ * Pool of interned strings. Each distinct string is stored only once and all its occurrences get the same
+ * string view (and the same handle), so interned strings can be compared by their data pointer or handle.
+ * Strings are copied into large blocks of memory which are never reallocated, so the views stay valid
+ * for the whole lifetime of the pool.
+ *
+ * All operations are synchronized so the pool can be shared between threads.
+ */
+class InterningPool
+{
+public:
+	static constexpr std::size_t BlockSize = 64 * 1024;
+
+	InterningPool() : _mutex(), _blocks(), _block_used(BlockSize), _large_strings(), _handles(), _strings() {}
+	InterningPool(const InterningPool&) = delete;
+	InterningPool(InterningPool&&) = delete;
+
+	/**
+	 * Returns the interned copy of the string.
+	 */
+	std::string_view intern(std::string_view str)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _strings[intern_unlocked(str)];
+	}
+
+	/**
+	 * Returns the handle of the interned copy of the string. Handles are numbered densely from 0.
+	 */
+	std::uint32_t get_handle(std::string_view str)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return intern_unlocked(str);
+	}
+
+	std::string_view get_string(std::uint32_t handle) const
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _strings[handle];
+	}
+
+	std::size_t size() const
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _strings.size();
+	}
+
+private:
+	std::uint32_t intern_unlocked(std::string_view str)
+	{
+		auto itr = _handles.find(str);
+		if (itr != _handles.end())
+			return itr->second;
+
+		auto stored = store(str);
+		auto handle = static_cast<std::uint32_t>(_strings.size());
+		_strings.push_back(stored);
+		_handles.emplace(stored, handle);
+		return handle;
+	}
+
+	std::string_view store(std::string_view str)
+	{
+		if (str.empty())
+			return std::string_view{};
+
+		// Strings which don't fit into the rest of the current block start a new one. Strings larger than
+		// the block are stored separately so the current block can still be used for the following strings.
+		char* data;
+		if (str.size() > BlockSize)
+		{
+			_large_strings.push_back(std::make_unique<char[]>(str.size()));
+			data = _large_strings.back().get();
+		}
+		else
+		{
+			if (BlockSize - _block_used < str.size())
+			{
+				_blocks.push_back(std::make_unique<char[]>(BlockSize));
+				_block_used = 0;
+			}
+
+			data = _blocks.back().get() + _block_used;
+			_block_used += str.size();
+		}
+
+		std::memcpy(data, str.data(), str.size());
+		return std::string_view{data, str.size()};
+	}
+
+	mutable std::mutex _mutex;
+	std::vector<std::unique_ptr<char[]>> _blocks;
+	std::size_t _block_used;
+	std::vector<std::unique_ptr<char[]>> _large_strings;
+	std::unordered_map<std::string_view, std::uint32_t> _handles;
+	std::vector<std::string_view> _strings;
+};
+
+} // namespace pog
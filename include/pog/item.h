@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cassert>
+#include <cstdint>
 #include <functional>
 #include <unordered_set>
 
@@ -16,10 +18,13 @@ public:
 	using SymbolType = Symbol<ValueT>;
 
 	Item(const RuleType* rule, std::size_t read_pos = 0)
-		: _rule(rule), _read_pos(read_pos) {}
+		: _rule(rule), _read_pos(static_cast<std::uint32_t>(read_pos)) {}
 	Item(const Item&) = default;
 	Item(Item&&) noexcept = default;
 
+	Item& operator=(const Item&) = default;
+	Item& operator=(Item&&) noexcept = default;
+
 	const RuleType* get_rule() const { return _rule; }
 	std::size_t get_read_pos() const { return _read_pos; }
 
@@ -33,7 +38,7 @@ public:
 		return is_final() ? nullptr : _rule->get_rhs()[_read_pos];
 	}
 
-	std::vector<const SymbolType*> get_left_side_without_read_symbol()
+	std::vector<const SymbolType*> get_left_side_without_read_symbol() const
 	{
 		if (_read_pos == 0)
 			return {};
@@ -44,7 +49,7 @@ public:
 		return result;
 	}
 
-	std::vector<const SymbolType*> get_right_side_without_read_symbol()
+	std::vector<const SymbolType*> get_right_side_without_read_symbol() const
 	{
 		if (is_final())
 		{
@@ -131,7 +136,7 @@ public:
 
 private:
 	const RuleType* _rule;
-	std::size_t _read_pos;
+	std::uint32_t _read_pos;
 };
 
 } // namespace pog
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <re2/re2.h>
+
+#include <pog/token.h>
+#include <pog/tokenizer.h>
+
+namespace pog {
+
+/**
+ * Compact record of the token read by Lexer. It refers to the symbol, the token and the tokenizer state only
+ * by their indices, so it has no semantic value and it doesn't own anything.
+ */
+struct LexedToken
+{
+	static constexpr std::uint32_t NoSymbol = std::numeric_limits<std::uint32_t>::max();
+
+	std::uint32_t symbol; ///< Index of the symbol of the token or NoSymbol if the token has no symbol
+	std::uint32_t token; ///< Index of the token which was matched
+	std::uint32_t state; ///< Index of the tokenizer state in which the token was matched
+	std::uint32_t length;
+	std::size_t offset;
+};
+
+/**
+ * Reads tokens from the input using the tokens of the parser but without the parser itself. Tokens are returned
+ * as compact records and their actions are not performed unless value of the token is requested. Tokenizer states
+ * are entered only by transitions of the tokens because there are no actions which could enter them. Tokens without
+ * symbol are returned too and the end of the input is never returned as a token.
+ *
+ * Lexer only reads the compiled tokens of the parser, so multiple lexers can read different inputs at the same time.
+ * Parser needs to be prepared first and it needs to outlive the lexer. Input isn't copied, so it needs to outlive the lexer too.
+ */
+template <typename ValueT>
+class Lexer
+{
+public:
+	using StateInfoType = StateInfo<ValueT>;
+	using TokenType = Token<ValueT>;
+	using TokenizerType = Tokenizer<ValueT>;
+
+	Lexer(const TokenizerType* tokenizer, std::string_view input) : _tokenizer(tokenizer), _input(input), _remaining(input.data(), input.size()),
+		_state(nullptr), _transitions(tokenizer->get_tokens().size(), nullptr), _matched_patterns()
+	{
+		enter_state(std::string{TokenizerType::DefaultState});
+
+		// States which tokens enter are looked up just once so each transition costs nothing
+		for (const auto& token : tokenizer->get_tokens())
+		{
+			if (token->has_transition_to_state())
+				_transitions[token->get_index()] = find_state(token->get_transition_to_state());
+		}
+	}
+
+	/**
+	 * Reads the next token. Returns nothing at the end of the input or if the input couldn't be tokenized, see at_end().
+	 */
+	std::optional<LexedToken> next()
+	{
+		if (_remaining.empty())
+			return std::nullopt;
+
+		auto [token, length] = TokenizerType::match(_state, _remaining, _matched_patterns);
+
+		// Empty match wouldn't move us anywhere so it's as good as no match
+		if (!token || length == 0)
+			return std::nullopt;
+
+		LexedToken result{
+			token->has_symbol() ? token->get_symbol()->get_index() : LexedToken::NoSymbol,
+			token->get_index(),
+			_state->index,
+			static_cast<std::uint32_t>(length),
+			get_offset()
+		};
+
+		_remaining.remove_prefix(length);
+		if (const auto* next_state = _transitions[token->get_index()])
+			_state = next_state;
+
+		return result;
+	}
+
+	/**
+	 * Reads at most count tokens and appends them to the given vector, so the storage of tokens can be reused between batches.
+	 * Returns the number of tokens read, which is less than count only at the end of the input or if the input couldn't be tokenized.
+	 */
+	std::size_t read(std::vector<LexedToken>& tokens, std::size_t count)
+	{
+		std::size_t read_count = 0;
+		for (; read_count < count; ++read_count)
+		{
+			auto token = next();
+			if (!token)
+				break;
+
+			tokens.push_back(token.value());
+		}
+
+		return read_count;
+	}
+
+	bool at_end() const
+	{
+		return _remaining.empty();
+	}
+
+	/**
+	 * Offset in the input where the next token will be read from.
+	 */
+	std::size_t get_offset() const
+	{
+		return static_cast<std::size_t>(_remaining.data() - _input.data());
+	}
+
+	const std::string& get_state() const
+	{
+		return _state->name;
+	}
+
+	void enter_state(const std::string& state)
+	{
+		_state = find_state(state);
+		assert(_state && "Transition to unknown state in lexer");
+	}
+
+	const std::string& get_state_name(const LexedToken& token) const
+	{
+		return _tokenizer->_states[token.state]->name;
+	}
+
+	const TokenType* get_token(const LexedToken& token) const
+	{
+		return _tokenizer->get_tokens()[token.token].get();
+	}
+
+	std::string_view get_text(const LexedToken& token) const
+	{
+		return _input.substr(token.offset, token.length);
+	}
+
+	/**
+	 * Performs action of the token and returns its value. Tokens without action have default value.
+	 */
+	ValueT get_value(const LexedToken& token) const
+	{
+		const auto* lexed_token = get_token(token);
+		return lexed_token->has_action() ? lexed_token->perform_action(get_text(token)) : ValueT{};
+	}
+
+private:
+	const StateInfoType* find_state(const std::string& state) const
+	{
+		auto itr = _tokenizer->_state_info.find(state);
+		return itr != _tokenizer->_state_info.end() ? &itr->second : nullptr;
+	}
+
+	const TokenizerType* _tokenizer;
+	std::string_view _input;
+	re2::StringPiece _remaining;
+	const StateInfoType* _state;
+	std::vector<const StateInfoType*> _transitions; ///< States entered by tokens indexed by index of the token
+	std::vector<int> _matched_patterns;
+};
+
+} // namespace pog
@@ -0,0 +1,349 @@
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace pog {
+
+/**
+ * Set of bytes which can start the match of the matcher.
+ */
+using ByteSet = std::bitset<256>;
+
+/**
+ * Matcher can tell which bytes its match can start with using first_bytes(), so tokenizer tries it only for them.
+ */
+template <typename MatcherT, typename = void>
+struct HasFirstBytes : std::false_type {};
+
+template <typename MatcherT>
+struct HasFirstBytes<MatcherT, std::void_t<decltype(std::declval<const MatcherT&>().first_bytes())>> : std::true_type {};
+
+/**
+ * Returns bytes which can start the match of the matcher. Matchers which don't know are tried for every byte.
+ */
+template <typename MatcherT>
+ByteSet get_first_bytes(const MatcherT& matcher)
+{
+	if constexpr (HasFirstBytes<MatcherT>::value)
+		return matcher.first_bytes();
+	else
+		return ByteSet{}.set();
+}
+
+/**
+ * Matchers which can be used instead of regular expressions in tokens. Matcher is a callable which receives
+ * the remaining input and returns the length of the match at its start or 0 if it doesn't match.
+ *
+ * Matchers only find the end of the token, value of the token is still produced by its action. Functions like decimal_value()
+ * convert the matched text without copying it (only float_value() copies it).
+ */
+namespace matchers {
+
+namespace detail {
+
+inline ByteSet byte_range(unsigned char first, unsigned char last)
+{
+	ByteSet result;
+	for (auto byte = first; byte <= last; ++byte)
+		result.set(byte);
+	return result;
+}
+
+inline bool is_digit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+inline bool is_hex_digit(char c)
+{
+	return is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+inline int hex_digit_value(char c)
+{
+	return is_digit(c) ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : c - 'A' + 10;
+}
+
+inline std::size_t count_digits(std::string_view input, std::size_t pos)
+{
+	auto start = pos;
+	while (pos < input.size() && is_digit(input[pos]))
+		++pos;
+	return pos - start;
+}
+
+inline bool is_identifier_start(char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+inline bool is_identifier_char(char c)
+{
+	return is_identifier_start(c) || is_digit(c);
+}
+
+inline bool has_hex_prefix(std::string_view input)
+{
+	return input.size() > 1 && input[0] == '0' && (input[1] == 'x' || input[1] == 'X');
+}
+
+} // namespace detail
+
+/**
+ * Decimal integer without sign like 42. It matches all digits even if the number wouldn't fit into any integer type.
+ */
+struct DecimalNumber
+{
+	std::size_t operator()(std::string_view input) const
+	{
+		return detail::count_digits(input, 0);
+	}
+
+	ByteSet first_bytes() const { return detail::byte_range('0', '9'); }
+};
+
+/**
+ * Hexadecimal integer with 0x (or 0X) prefix like 0x2A.
+ */
+struct HexNumber
+{
+	std::size_t operator()(std::string_view input) const
+	{
+		if (!detail::has_hex_prefix(input))
+			return 0;
+
+		std::size_t length = 2;
+		while (length < input.size() && detail::is_hex_digit(input[length]))
+			++length;
+		return length == 2 ? 0 : length;
+	}
+
+	ByteSet first_bytes() const { return detail::byte_range('0', '0'); }
+};
+
+/**
+ * Floating point number without sign like 3.14, .5 or 1e-3. Integers like 42 are matched too, so if you also have
+ * token for integers, it should be added first to win over this one.
+ */
+struct FloatNumber
+{
+	std::size_t operator()(std::string_view input) const
+	{
+		auto length = detail::count_digits(input, 0);
+		auto integral = length;
+		if (length < input.size() && input[length] == '.')
+		{
+			auto fraction = detail::count_digits(input, length + 1);
+			// Lone dot is not a number
+			if (integral == 0 && fraction == 0)
+				return 0;
+			length += 1 + fraction;
+		}
+		else if (integral == 0)
+			return 0;
+
+		// Exponent is part of the number only if there are digits in it
+		if (length < input.size() && (input[length] == 'e' || input[length] == 'E'))
+		{
+			auto sign = length + 1 < input.size() && (input[length + 1] == '+' || input[length + 1] == '-') ? 1 : 0;
+			auto exponent = detail::count_digits(input, length + 1 + sign);
+			if (exponent > 0)
+				length += 1 + sign + exponent;
+		}
+
+		return length;
+	}
+
+	ByteSet first_bytes() const { return detail::byte_range('0', '9').set('.'); }
+};
+
+/**
+ * C-style identifier like foo_bar1.
+ */
+struct Identifier
+{
+	std::size_t operator()(std::string_view input) const
+	{
+		if (input.empty() || !detail::is_identifier_start(input[0]))
+			return 0;
+
+		std::size_t length = 1;
+		while (length < input.size() && detail::is_identifier_char(input[length]))
+			++length;
+		return length;
+	}
+
+	ByteSet first_bytes() const { return detail::byte_range('a', 'z') | detail::byte_range('A', 'Z') | ByteSet{}.set('_'); }
+};
+
+/**
+ * String enclosed in quotes where escape character makes the following character (including the quote) part of the string.
+ * Unterminated string doesn't match at all.
+ */
+struct QuotedString
+{
+	char quote;
+	char escape;
+
+	std::size_t operator()(std::string_view input) const
+	{
+		if (input.empty() || input[0] != quote)
+			return 0;
+
+		for (std::size_t i = 1; i < input.size(); ++i)
+		{
+			if (input[i] == escape)
+				++i;
+			else if (input[i] == quote)
+				return i + 1;
+		}
+
+		return 0;
+	}
+
+	ByteSet first_bytes() const { return ByteSet{}.set(static_cast<unsigned char>(quote)); }
+};
+
+/**
+ * Comment which starts with the prefix and lasts until the end of the line. The new line itself isn't part of the comment.
+ */
+struct LineComment
+{
+	std::string prefix;
+
+	std::size_t operator()(std::string_view input) const
+	{
+		if (input.substr(0, prefix.size()) != prefix)
+			return 0;
+
+		auto end = input.find('\n', prefix.size());
+		return end == std::string_view::npos ? input.size() : end;
+	}
+
+	ByteSet first_bytes() const { return prefix.empty() ? ByteSet{}.set() : ByteSet{}.set(static_cast<unsigned char>(prefix[0])); }
+};
+
+inline DecimalNumber decimal()
+{
+	return DecimalNumber{};
+}
+
+inline HexNumber hex()
+{
+	return HexNumber{};
+}
+
+inline FloatNumber floating()
+{
+	return FloatNumber{};
+}
+
+inline Identifier identifier()
+{
+	return Identifier{};
+}
+
+inline QuotedString quoted_string(char quote = '"', char escape = '\\')
+{
+	return QuotedString{quote, escape};
+}
+
+inline LineComment line_comment(std::string prefix = "//")
+{
+	return LineComment{std::move(prefix)};
+}
+
+/**
+ * Converts text matched by decimal() into the number.
+ */
+template <typename T>
+T decimal_value(std::string_view str)
+{
+	T result{};
+	for (std::size_t i = 0; i < str.size() && detail::is_digit(str[i]); ++i)
+		result = static_cast<T>(result * 10 + (str[i] - '0'));
+	return result;
+}
+
+/**
+ * Converts text matched by hex() into the number.
+ */
+template <typename T>
+T hex_value(std::string_view str)
+{
+	T result{};
+	if (detail::has_hex_prefix(str))
+		str.remove_prefix(2);
+	for (std::size_t i = 0; i < str.size() && detail::is_hex_digit(str[i]); ++i)
+		result = static_cast<T>(result * 16 + detail::hex_digit_value(str[i]));
+	return result;
+}
+
+/**
+ * Converts text matched by floating() into the number. The text is copied because strtod() needs null-terminated
+ * string, so the decimal point is the one of the current C locale.
+ */
+template <typename T>
+T float_value(std::string_view str)
+{
+	std::string copy{str};
+	if constexpr (std::is_same_v<T, float>)
+		return std::strtof(copy.c_str(), nullptr);
+	else if constexpr (std::is_same_v<T, long double>)
+		return std::strtold(copy.c_str(), nullptr);
+	else
+		return static_cast<T>(std::strtod(copy.c_str(), nullptr));
+}
+
+/**
+ * Converts text matched by quoted_string() into the string without quotes. Escape sequences \n, \t, \r and \0 are replaced
+ * with the characters they stand for, any other escaped character stands for itself.
+ */
+inline std::string string_value(std::string_view str, char escape = '\\')
+{
+	std::string result;
+	if (str.size() < 2)
+		return result;
+
+	str = str.substr(1, str.size() - 2);
+	result.reserve(str.size());
+	for (std::size_t i = 0; i < str.size(); ++i)
+	{
+		if (str[i] != escape || i + 1 == str.size())
+		{
+			result.push_back(str[i]);
+			continue;
+		}
+
+		switch (str[++i])
+		{
+			case 'n':
+				result.push_back('\n');
+				break;
+			case 't':
+				result.push_back('\t');
+				break;
+			case 'r':
+				result.push_back('\r');
+				break;
+			case '0':
+				result.push_back('\0');
+				break;
+			default:
+				result.push_back(str[i]);
+				break;
+		}
+	}
+
+	return result;
+}
+
+} // namespace matchers
+
+} // namespace pog
@@ -0,0 +1,73 @@
+#pragma once
+
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#endif
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pog {
+
+/**
+ * Memory resources and containers which allocate from them. They are the ones from std::pmr if the standard library
+ * provides them. Standard libraries without them (like libstdc++ of GCC 7 or libc++ before version 16) get stand-ins
+ * which keep the memory resource around but always allocate using std::allocator.
+ */
+namespace pmr {
+
+#ifdef __cpp_lib_memory_resource
+
+using std::pmr::memory_resource;
+using std::pmr::get_default_resource;
+
+template <typename T>
+using polymorphic_allocator = std::pmr::polymorphic_allocator<T>;
+
+#else
+
+class memory_resource
+{
+public:
+	virtual ~memory_resource() = default;
+};
+
+inline memory_resource* get_default_resource() noexcept
+{
+	static memory_resource resource;
+	return &resource;
+}
+
+template <typename T>
+class polymorphic_allocator
+{
+public:
+	using value_type = T;
+
+	polymorphic_allocator(memory_resource* resource = get_default_resource()) noexcept : _resource(resource) {}
+	template <typename U> polymorphic_allocator(const polymorphic_allocator<U>& other) noexcept : _resource(other.resource()) {}
+
+	T* allocate(std::size_t n) { return std::allocator<T>{}.allocate(n); }
+	void deallocate(T* p, std::size_t n) { std::allocator<T>{}.deallocate(p, n); }
+
+	memory_resource* resource() const { return _resource; }
+
+	template <typename U> bool operator==(const polymorphic_allocator<U>&) const { return true; }
+	template <typename U> bool operator!=(const polymorphic_allocator<U>&) const { return false; }
+
+private:
+	memory_resource* _resource;
+};
+
+#endif
+
+template <typename T>
+using vector = std::vector<T, polymorphic_allocator<T>>;
+
+using string = std::basic_string<char, std::char_traits<char>, polymorphic_allocator<char>>;
+
+} // namespace pmr
+
+} // namespace pog
@@ -25,32 +25,63 @@ namespace pog {
  *
  * So Follow(q, A) represents what symbols can follow A while in state q. It is constructed from
  * generated follow using Read(q, A) and propagated follow using include relation.
+ *
+ * Tuples (q,x) are represented by ids of nonterminal transitions assigned by the automaton.
  */
 template <typename ValueT>
-class Follow : public Operation<ValueT, StateAndSymbol<ValueT>, const Symbol<ValueT>*>
+class Follow : public Operation<ValueT>
 {
 public:
-	using Parent = Operation<ValueT, StateAndSymbol<ValueT>, const Symbol<ValueT>*>;
+	using Parent = Operation<ValueT>;
 
 	using AutomatonType = Automaton<ValueT>;
 	using GrammarType = Grammar<ValueT>;
 
 	using StateAndSymbolType = StateAndSymbol<ValueT>;
 
-	Follow(const AutomatonType* automaton, const GrammarType* grammar, const Includes<ValueT>& includes, Read<ValueT>& read_op)
-		: Parent(automaton, grammar), _includes(includes), _read_op(read_op) {}
+	Follow(const AutomatonType* automaton, const GrammarType* grammar, const Includes<ValueT>& includes, const Read<ValueT>& read_op)
+		: Parent(automaton, grammar), _includes(includes), _read_op(read_op), _depths() {}
 	Follow(const Follow&) = delete;
 	Follow(Follow&&) noexcept = default;
 
 	virtual void calculate() override
 	{
 		// We use digraph algorithm which calculates Follow() for us. See digraph_algo() for more information.
-		digraph_algo<StateAndSymbolType>(_includes, _read_op, Parent::_operation);
+		// Read() serves as a base function F'(x) so it's the initial value of Follow().
+		Parent::_operation = _read_op.get_all();
+		digraph_algo(_includes, Parent::_operation);
+	}
+
+	virtual void calculate_lazily() override
+	{
+		Parent::calculate_lazily();
+		_depths.assign(Parent::size(), 0);
+	}
+
+protected:
+	virtual std::size_t node_count() const override
+	{
+		return Parent::_automaton->get_nonterminal_transitions().size();
+	}
+
+	virtual void compute(std::uint32_t id) const override
+	{
+		// Traverse only the part of includes relation reachable from the requested node. Once the traversal
+		// is over, every node visited during it has its final Follow() set.
+		std::vector<std::uint32_t> visited;
+		digraph_traverse(_includes, Parent::_operation, _depths, id, [&](std::uint32_t x) {
+			Parent::_operation[x] = _read_op[x];
+			visited.push_back(x);
+		});
+
+		for (auto x : visited)
+			Parent::_computed.set(x);
 	}
 
 private:
 	const Includes<ValueT>& _includes;
-	Read<ValueT>& _read_op;
+	const Read<ValueT>& _read_op;
+	mutable std::vector<std::size_t> _depths;
 };
 
 } // namespace pog
@@ -3,7 +3,6 @@
 #include <pog/operations/operation.h>
 #include <pog/operations/follow.h>
 #include <pog/relations/lookback.h>
-#include <pog/types/state_and_rule.h>
 
 namespace pog {
 
@@ -20,56 +19,54 @@ namespace pog {
  * 2. Lookback relation represents that in order to preform some reduction A -> x in state q, we first
  *    had to go through some other state p and use what follows A in B -> a A b to know when to perform
  *    reduction.
- * So we'll take all rules A -> x and find in which state they can be reduced (there is an item A -> x <*>).
+ * So we'll take all states with final items A -> x <*> (automaton keeps track of them as reductions).
  * We'll then union all Follow() sets according to lookback relation and for each state and rule, we now
  * know what symbols need to follow in order to perform reductions by such rule in that particular state.
+ *
+ * Tuples (q, R) are represented by ids of reductions assigned by the automaton.
  */
 template <typename ValueT>
-class Lookahead : public Operation<ValueT, StateAndRule<ValueT>, const Symbol<ValueT>*>
+class Lookahead : public Operation<ValueT>
 {
 public:
-	using Parent = Operation<ValueT, StateAndRule<ValueT>, const Symbol<ValueT>*>;
+	using Parent = Operation<ValueT>;
 
 	using AutomatonType = Automaton<ValueT>;
 	using GrammarType = Grammar<ValueT>;
 
-	using StateAndRuleType = StateAndRule<ValueT>;
-
-	// TODO: Follow<> should not be non-const but we need it for operator[]
-	Lookahead(const AutomatonType* automaton, const GrammarType* grammar, const Lookback<ValueT>& lookback, Follow<ValueT>& follow_op)
+	Lookahead(const AutomatonType* automaton, const GrammarType* grammar, const Lookback<ValueT>& lookback, const Follow<ValueT>& follow_op)
 		: Parent(automaton, grammar), _lookback(lookback), _follow_op(follow_op) {}
 	Lookahead(const Lookahead&) = delete;
 	Lookahead(Lookahead&&) noexcept = default;
 
 	virtual void calculate() override
 	{
-		// Iterate over all rules in grammar
-		for (const auto& rule : Parent::_grammar->get_rules())
-		{
-			for (const auto& state : Parent::_automaton->get_states())
-			{
-				// Find lookback of the current state and rule
-				auto sr = StateAndRuleType{state.get(), rule.get()};
-				auto lookback_with = _lookback.find(sr);
-				if (!lookback_with)
-					continue;
+		Parent::reset(node_count());
+
+		// Iterate over all final items A -> x <*> recorded in the automaton together with their states
+		for (std::uint32_t id = 0; id < Parent::size(); ++id)
+			compute(id);
+	}
+
+protected:
+	virtual std::size_t node_count() const override
+	{
+		return Parent::_automaton->get_reductions().size();
+	}
 
-				// Union all Follow() sets of the current state and rule to compute Lookahead()
-				for (const auto& ss : *lookback_with)
-				{
-					if (auto itr = Parent::_operation.find(sr); itr == Parent::_operation.end())
-						Parent::_operation.emplace(std::move(sr), _follow_op[ss]);
-					else if (auto follow_res = _follow_op.find(ss); follow_res)
-						std::copy(follow_res->begin(), follow_res->end(), std::inserter(itr->second, itr->second.begin()));
-				}
-			}
-		}
+	virtual void compute(std::uint32_t id) const override
+	{
+		// Union all Follow() sets of the current state and rule to compute Lookahead()
+		auto& result = Parent::_operation[id];
+		for (auto transition_id : _lookback[id])
+			result |= _follow_op[transition_id];
 
+		Parent::_computed.set(id);
 	}
 
 private:
 	const Lookback<ValueT>& _lookback;
-	Follow<ValueT>& _follow_op;
+	const Follow<ValueT>& _follow_op;
 };
 
 } // namespace pog
@@ -1,54 +1,79 @@
 #pragma once
 
-#include <unordered_map>
-#include <unordered_set>
+#include <cstdint>
+#include <vector>
 
 #include <pog/automaton.h>
+#include <pog/bitset.h>
 #include <pog/grammar.h>
 
 namespace pog {
 
-template <typename ValueT, typename ArgT, typename ResT>
+/**
+ * Operation maps densely numbered nodes (nonterminal transitions or reductions, see Automaton)
+ * to a set of symbols. Sets are represented as bitsets indexed by symbol indices and stored
+ * in a vector indexed by the id of the node.
+ *
+ * Operation can also be calculated lazily. In that case, the set of the node is computed only
+ * once it is requested for the first time. Lazy calculation isn't thread-safe on its own,
+ * the caller needs to take care of synchronization.
+ */
+template <typename ValueT>
 class Operation
 {
 public:
 	using AutomatonType = Automaton<ValueT>;
 	using GrammarType = Grammar<ValueT>;
 
-	Operation(const AutomatonType* automaton, const GrammarType* grammar) : _automaton(automaton), _grammar(grammar) {}
+	Operation(const AutomatonType* automaton, const GrammarType* grammar) : _automaton(automaton), _grammar(grammar), _operation(),
+		_lazy(false), _computed() {}
 	Operation(const Operation&) = delete;
 	Operation(Operation&&) noexcept = default;
 	virtual ~Operation() = default;
 
 	virtual void calculate() = 0;
 
-	auto& operator[](const ArgT& key) { return _operation[key]; }
-	auto& operator[](ArgT& key) { return _operation[key]; }
-
-	template <typename T>
-	std::unordered_set<ResT>* find(const T& key)
+	virtual void calculate_lazily()
 	{
-		auto itr = _operation.find(key);
-		if (itr == _operation.end())
-			return nullptr;
-
-		return &itr->second;
+		_lazy = true;
+		reset(node_count());
 	}
 
-	template <typename T>
-	const std::unordered_set<ResT>* find(const T& key) const
+	std::size_t size() const { return _operation.size(); }
+
+	const Bitset& operator[](std::uint32_t id) const
 	{
-		auto itr = _operation.find(key);
-		if (itr == _operation.end())
-			return nullptr;
+		if (_lazy && !_computed.test(id))
+			compute(id);
 
-		return &itr->second;
+		return _operation[id];
 	}
 
+	const std::vector<Bitset>& get_all() const { return _operation; }
+
 protected:
+	/**
+	 * Number of nodes which operation maps to sets.
+	 */
+	virtual std::size_t node_count() const = 0;
+
+	/**
+	 * Computes the set of the given node and marks it as computed. Used for lazy calculation.
+	 */
+	virtual void compute(std::uint32_t id) const = 0;
+
+	void reset(std::size_t node_count)
+	{
+		_operation.assign(node_count, Bitset{_grammar->get_symbols().size()});
+		_computed = Bitset{node_count};
+	}
+
 	const AutomatonType* _automaton;
 	const GrammarType* _grammar;
-	std::unordered_map<ArgT, std::unordered_set<ResT>> _operation;
+	mutable std::vector<Bitset> _operation;
+
+	bool _lazy;
+	mutable Bitset _computed;
 };
 
 } // namespace pog
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cassert>
+
 #include <pog/operations/operation.h>
 #include <pog/types/state_and_symbol.h>
 
@@ -15,15 +17,18 @@ namespace pog {
  * incorporates situation if some symbol in sequence b can be reduced to empty string.
  *
  * So to put it shortly, for state Q and item A -> a <*> B b, Read(Q, B) = First(b).
+ *
+ * Tuples (q,x) are represented by ids of nonterminal transitions assigned by the automaton.
  */
 template <typename ValueT>
-class Read : public Operation<ValueT, StateAndSymbol<ValueT>, const Symbol<ValueT>*>
+class Read : public Operation<ValueT>
 {
 public:
-	using Parent = Operation<ValueT, StateAndSymbol<ValueT>, const Symbol<ValueT>*>;
+	using Parent = Operation<ValueT>;
 
 	using AutomatonType = Automaton<ValueT>;
 	using GrammarType = Grammar<ValueT>;
+	using ItemType = Item<ValueT>;
 	using SymbolType = Symbol<ValueT>;
 
 	using StateAndSymbolType = StateAndSymbol<ValueT>;
@@ -34,37 +39,59 @@ public:
 
 	virtual void calculate() override
 	{
+		Parent::reset(node_count());
+
 		// Iterate over all states of LR automaton
 		for (const auto& state : Parent::_automaton->get_states())
 		{
 			for (const auto& item : *state.get())
 			{
 				// We don't care about final items, only those in form A -> a <*> B b
-				if (item->is_final())
+				if (item.is_final())
 					continue;
 
 				// Symbol right to <*> needs to be nonterminal
-				auto next_symbol = item->get_read_symbol();
+				auto next_symbol = item.get_read_symbol();
 				if (!next_symbol->is_nonterminal())
 					continue;
 
-				// Observe everything right of B, so in this case 'b' and calculate First()
-				auto right_rest = item->get_right_side_without_read_symbol();
-				auto symbols = Parent::_grammar->first(right_rest);
-
 				// Insert operation result
-				auto ss = StateAndSymbolType{state.get(), next_symbol};
-				auto itr = Parent::_operation.find(ss);
-				if (itr == Parent::_operation.end())
-					Parent::_operation.emplace(std::move(ss), std::move(symbols));
-				else
-				{
-					// TODO: std::vector + std::set_union or std::unordered_set::extract
-					std::copy(symbols.begin(), symbols.end(), std::inserter(itr->second, itr->second.begin()));
-				}
+				auto id = Parent::_automaton->get_nonterminal_transition_id(state.get(), next_symbol);
+				assert(id && "Nonterminal transition is not numbered. This shouldn't happen");
+
+				add_first_of_rest(item, Parent::_operation[id.value()]);
 			}
 		}
 	}
+
+protected:
+	virtual std::size_t node_count() const override
+	{
+		return Parent::_automaton->get_nonterminal_transitions().size();
+	}
+
+	virtual void compute(std::uint32_t id) const override
+	{
+		// Only items A -> a <*> B b where B is the symbol of the transition are interesting
+		const auto& ss = Parent::_automaton->get_nonterminal_transitions()[id];
+		for (const auto& item : *ss.state)
+		{
+			if (item.get_read_symbol() == ss.symbol)
+				add_first_of_rest(item, Parent::_operation[id]);
+		}
+
+		Parent::_computed.set(id);
+	}
+
+private:
+	void add_first_of_rest(const ItemType& item, Bitset& result) const
+	{
+		// Observe everything right of B, so in this case 'b' and calculate First()
+		auto right_rest = item.get_right_side_without_read_symbol();
+		auto symbols = Parent::_grammar->first(right_rest);
+		for (const auto* sym : symbols)
+			result.set(sym->get_index());
+	}
 };
 
 } // namespace pog
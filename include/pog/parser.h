@@ -1,6 +1,10 @@
 #pragma once
 
-#include <deque>
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <type_traits>
 #include <unordered_map>
 
 #include <fmt/format.h>
@@ -17,15 +21,23 @@
 
 #include <pog/action.h>
 #include <pog/automaton.h>
+#include <pog/checkpoint.h>
+#include <pog/cst.h>
 #include <pog/errors.h>
 #include <pog/grammar.h>
+#include <pog/lexer.h>
+#include <pog/matchers.h>
+#include <pog/memory_resource.h>
 #include <pog/parser_report.h>
 #include <pog/parsing_table.h>
+#include <pog/reduction_log.h>
 #include <pog/rule_builder.h>
 #include <pog/state.h>
 #include <pog/symbol.h>
 #include <pog/token_builder.h>
 #include <pog/tokenizer.h>
+#include <pog/validation_result.h>
+#include <pog/value_handler.h>
 
 #include <pog/operations/read.h>
 #include <pog/operations/follow.h>
@@ -49,8 +61,12 @@ public:
 	using ReduceActionType = Reduce<ValueT>;
 
 	using BacktrackingInfoType = BacktrackingInfo<ValueT>;
+	using CheckpointType = Checkpoint<ValueT>;
+	using CstType = Cst<ValueT>;
 	using ItemType = Item<ValueT>;
+	using LexerType = Lexer<ValueT>;
 	using ParserReportType = ParserReport<ValueT>;
+	using ReductionLogType = ReductionLog<ValueT>;
 	using RuleBuilderType = RuleBuilder<ValueT>;
 	using RuleType = Rule<ValueT>;
 	using StateType = State<ValueT>;
@@ -61,10 +77,12 @@ public:
 	using TokenMatchType = TokenMatch<ValueT>;
 	using TokenType = Token<ValueT>;
 	using TokenizerType = Tokenizer<ValueT>;
+	using ValidationResultType = ValidationResult<ValueT>;
 
 	Parser() : _grammar(), _tokenizer(&_grammar), _automaton(&_grammar), _includes(&_automaton, &_grammar),
 		_lookback(&_automaton, &_grammar), _read_operation(&_automaton, &_grammar), _follow_operation(&_automaton, &_grammar, _includes, _read_operation),
-		_lookahead_operation(&_automaton, &_grammar, _lookback, _follow_operation), _parsing_table(&_automaton, &_grammar, _lookahead_operation)
+		_lookahead_operation(&_automaton, &_grammar, _lookback, _follow_operation), _parsing_table(&_automaton, &_grammar, _lookahead_operation),
+		_memory_resource(pmr::get_default_resource()), _session(), _session_id(0)
 	{
 		static_assert(std::is_default_constructible_v<ValueT>, "Value type needs to be default constructible");
 	}
@@ -72,19 +90,52 @@ public:
 	Parser(const Parser<ValueT>&) = delete;
 	Parser(Parser<ValueT>&&) noexcept = default;
 
-	const ParserReportType& prepare()
+	/**
+	 * Prepares the parser for parsing. With lazy table construction, only LR automaton is built here
+	 * and the rest of the parsing table is calculated on demand while parsing. Conflicts in the grammar
+	 * are reported only with eager table construction.
+	 *
+	 * Parser can be prepared again after new tokens or rules were added. Only the new tokens and rules
+	 * are processed, tokenizer states and LR states which weren't affected by them are reused.
+	 */
+	const ParserReportType& prepare(TableConstruction construction = TableConstruction::Eager)
 	{
 		for (auto& tb : _token_builders)
 			tb.done();
 		for (auto& rb : _rule_builders)
 			rb.done();
+		_token_builders.clear();
+		_rule_builders.clear();
+
+		_report = ParserReportType{};
+		_grammar.inline_symbols();
+		auto pruned = _grammar.prune();
+		for (const auto* symbol : pruned.symbols)
+			_report.add_pruned_symbol(symbol);
+		for (const auto* rule : pruned.rules)
+			_report.add_pruned_rule(rule);
+
 		_automaton.construct_states();
-		_includes.calculate();
-		_lookback.calculate();
-		_read_operation.calculate();
-		_follow_operation.calculate();
-		_lookahead_operation.calculate();
-		_parsing_table.calculate(_report);
+		if (construction == TableConstruction::Lazy)
+		{
+			// Lookaheads of the state depend on all of its predecessors so we still need to construct
+			// the whole LR automaton but everything else can wait until it's needed
+			_includes.calculate_lazily();
+			_lookback.calculate_lazily();
+			_read_operation.calculate_lazily();
+			_follow_operation.calculate_lazily();
+			_lookahead_operation.calculate_lazily();
+			_parsing_table.calculate_lazily();
+		}
+		else
+		{
+			_includes.calculate();
+			_lookback.calculate();
+			_read_operation.calculate();
+			_follow_operation.calculate();
+			_lookahead_operation.calculate();
+			_parsing_table.calculate(_report);
+		}
 		_tokenizer.prepare();
 		return _report;
 	}
@@ -95,6 +146,16 @@ public:
 		return _token_builders.back();
 	}
 
+	/**
+	 * Adds token which is matched by the matcher instead of regular expression, see pog::matchers.
+	 */
+	template <typename MatcherT, typename = std::enable_if_t<std::is_invocable_r_v<std::size_t, MatcherT&, std::string_view>>>
+	TokenBuilderType& token(MatcherT&& matcher)
+	{
+		_token_builders.emplace_back(&_grammar, &_tokenizer, std::forward<MatcherT>(matcher));
+		return _token_builders.back();
+	}
+
 	TokenBuilderType& end_token()
 	{
 		_token_builders.emplace_back(&_grammar, &_tokenizer);
@@ -112,6 +173,16 @@ public:
 		_grammar.set_start_symbol(_grammar.add_symbol(SymbolKind::Nonterminal, name));
 	}
 
+	/**
+	 * Adds another start symbol which can be selected when parsing. All start symbols share the same parsing table,
+	 * so different entry points into the language don't need separate parsers. Start symbol still needs to be set
+	 * by set_start_symbol() and that one is used when no start symbol is selected.
+	 */
+	void add_start_symbol(const std::string& name)
+	{
+		_grammar.add_start_symbol(_grammar.add_symbol(SymbolKind::Nonterminal, name));
+	}
+
 	void enter_tokenizer_state(const std::string& state_name)
 	{
 		_tokenizer.enter_state(state_name);
@@ -127,6 +198,49 @@ public:
 		_tokenizer.pop_input_stream();
 	}
 
+	/**
+	 * With retained input, contents of all parsed inputs are kept by the parser until release_input() is called,
+	 * so actions of tokens can store the string views they receive into values and they outlive the result of parse.
+	 */
+	void retain_input(bool retain)
+	{
+		_tokenizer.set_retain_inputs(retain);
+	}
+
+	/**
+	 * Frees contents of all parsed inputs. Values referring to them can't be used anymore after this.
+	 */
+	void release_input()
+	{
+		_tokenizer.release_inputs();
+	}
+
+	/**
+	 * Sets memory resource from which the parser allocates its stacks and contents of the inputs while parsing.
+	 * Actions can use the same resource for their values, so everything allocated during parsing can be
+	 * released at once, for example with std::pmr::monotonic_buffer_resource. The resource needs to outlive
+	 * the values allocated from it (and retained inputs). Without <memory_resource> in the standard library,
+	 * the resource is only kept around and everything is allocated using std::allocator.
+	 */
+	void set_memory_resource(pmr::memory_resource* resource)
+	{
+		_memory_resource = resource;
+		_tokenizer.set_memory_resource(resource);
+	}
+
+	pmr::memory_resource* get_memory_resource() const
+	{
+		return _memory_resource;
+	}
+
+	/**
+	 * Pool in which texts of interned tokens are interned. You can use it to intern your own strings too.
+	 */
+	InterningPool& get_interning_pool()
+	{
+		return *_tokenizer.get_interning_pool();
+	}
+
 	void global_tokenizer_action(typename TokenizerType::CallbackType&& global_action)
 	{
 		_tokenizer.global_action(std::move(global_action));
@@ -134,41 +248,566 @@ public:
 
 	std::optional<ValueT> parse(std::istream& input)
 	{
-		_tokenizer.enter_state(std::string{decltype(_tokenizer)::DefaultState});
+		start_input(input);
+
+		ValueHandler<ValueT> handler(_memory_resource);
+		bool accepted = run(handler, true, throw_syntax_error);
+
+		if (!accepted)
+			return std::nullopt;
+
+		return handler.get_result();
+	}
+
+	/**
+	 * Parses the input starting from the given start symbol, which needs to be either the start symbol or one of the symbols added
+	 * by add_start_symbol().
+	 */
+	std::optional<ValueT> parse(std::istream& input, const std::string& start_symbol)
+	{
+		start_input(input);
+
+		ValueHandler<ValueT> handler(_memory_resource);
+		pmr::vector<std::uint32_t> stack(1, 0, _memory_resource);
+		auto token = start_token(start_symbol);
+		bool accepted = run(handler, stack, token, read_tokens(true), throw_syntax_error, [](const TokenMatchType&) { return true; });
+
+		if (!accepted)
+			return std::nullopt;
+
+		return handler.get_result();
+	}
+
+	/**
+	 * Returns lexer which reads tokens of this parser from the input without parsing it (see Lexer). Input isn't copied
+	 * so it needs to outlive the lexer.
+	 */
+	LexerType lexer(std::string_view input) const
+	{
+		return LexerType{&_tokenizer, input};
+	}
+
+	/**
+	 * Returns the symbol with the given name or nullptr if there is no such symbol. Tokens which are read outside
+	 * of the parser (see parse_tokens()) refer to symbols, so their names can be resolved just once before parsing.
+	 */
+	const SymbolType* get_symbol(const std::string& name) const
+	{
+		return _grammar.get_symbol(name);
+	}
+
+	/**
+	 * Parses tokens which were read outside of the parser instead of reading them from the input using tokenizer,
+	 * so any lexer can be used together with the parsing table and actions of this parser. Tokens are given either
+	 * as a range of TokenMatch or as a function which returns std::optional<TokenMatch> with the next token or nothing
+	 * at the end of the input. Symbols of the tokens need to be terminals of this parser (see get_symbol()). Tokens are
+	 * moved out of the range only if it is passed as rvalue. Syntax errors are thrown as in parse().
+	 */
+	template <typename TokensT>
+	std::optional<ValueT> parse_tokens(TokensT&& tokens)
+	{
+		return parse_given_tokens(std::forward<TokensT>(tokens), std::nullopt);
+	}
+
+	/**
+	 * Parses tokens which were read outside of the parser starting from the given start symbol (see parse()).
+	 */
+	template <typename TokensT>
+	std::optional<ValueT> parse_tokens(TokensT&& tokens, const std::string& start_symbol)
+	{
+		return parse_given_tokens(std::forward<TokensT>(tokens), start_token(start_symbol));
+	}
+
+	/**
+	 * Starts parsing the input step by step. Parsing then goes on with parse_until() and finish() and the parser
+	 * can be returned to the checkpoint created at any point in between, so the input can be parsed speculatively.
+	 */
+	void start(std::istream& input)
+	{
+		start_input(input);
+
+		pmr::vector<std::uint32_t> stack(1, 0, _memory_resource);
+		_session.emplace(Session{std::move(stack), ValueHandler<ValueT>(_memory_resource), std::nullopt, false});
+		++_session_id;
+	}
+
+	/**
+	 * Starts parsing the input step by step from the given start symbol (see parse()).
+	 */
+	void start(std::istream& input, const std::string& start_symbol)
+	{
+		start(input);
+		_session->token = start_token(start_symbol);
+	}
+
+	/**
+	 * Continues parsing until the next token starts at or after the offset in its input stream. Returns whether
+	 * the input was accepted before that. Parser needs to read that token (and perform its action) to know it should stop,
+	 * so it is already read when the parser stops. Syntax errors are thrown as in parse() and the parser stays right before
+	 * the unexpected token, so it can be restored to some checkpoint.
+	 */
+	bool parse_until(std::size_t offset)
+	{
+		assert(_session && "Parsing needs to be started first");
+
+		if (_session->accepted)
+			return true;
+
+		// Token which stopped the last step is still waiting to be processed
+		if (_session->token && _session->token.value().offset >= offset)
+			return false;
+
+		_session->accepted = run(_session->values, _session->stack, _session->token, read_tokens(true), throw_syntax_error, [&](const TokenMatchType& token) {
+			return token.offset < offset;
+		});
+		return _session->accepted;
+	}
+
+	/**
+	 * Parses the rest of the input and returns the result in the same way as parse().
+	 */
+	std::optional<ValueT> finish()
+	{
+		if (!parse_until(std::numeric_limits<std::size_t>::max()))
+			return std::nullopt;
+
+		return _session->values.get_result();
+	}
+
+	/**
+	 * Creates checkpoint of parsing started by start(). It doesn't copy any semantic values, those which are on the stack
+	 * are copied only once parser is about to change them for the first time. Actions of rules and tokens are not undone by restoring
+	 * the checkpoint, so it should be used only with actions that have no side effects other than their values. The same goes for sinks.
+	 */
+	CheckpointType checkpoint()
+	{
+		assert(_session && "Parsing needs to be started first");
+
+		return CheckpointType{
+			_session_id,
+			std::vector<std::uint32_t>(_session->stack.begin(), _session->stack.end()),
+			_session->values.checkpoint(),
+			_session->token,
+			_tokenizer.checkpoint(),
+			_session->accepted
+		};
+	}
+
+	/**
+	 * Returns the parser into the state it had when the checkpoint was created. Checkpoint can be restored many times
+	 * but restoring it invalidates all checkpoints created after it.
+	 */
+	void restore(const CheckpointType& checkpoint)
+	{
+		assert(_session && checkpoint.session == _session_id && "Checkpoint doesn't belong to the current parsing");
+
+		_session->stack.assign(checkpoint.stack.begin(), checkpoint.stack.end());
+		_session->values.restore(checkpoint.values);
+		_session->token = checkpoint.token;
+		_session->accepted = checkpoint.accepted;
+		_tokenizer.restore(checkpoint.tokenizer);
+	}
+
+	/**
+	 * Invalidates all checkpoints of the current parsing, so the parser no longer needs to keep copies of the values for them.
+	 */
+	void release_checkpoints()
+	{
+		assert(_session && "Parsing needs to be started first");
+
+		_session->values.release_checkpoints();
+		++_session_id;
+	}
+
+	/**
+	 * Parses the input into concrete syntax tree without performing any actions of tokens (including global tokenizer
+	 * action) or rules. Tree has node for every token and every reduction of the parser. Unit rules without action are
+	 * skipped by the parsing table, so they don't have nodes in the tree. Syntax errors are thrown as in parse().
+	 */
+	std::optional<CstType> parse_cst(std::istream& input)
+	{
+		start_input(input, true);
+
+		pmr::vector<std::uint32_t> stack(1, 0, _memory_resource);
+		CstHandler handler(CstType{_memory_resource}, &_tokenizer, &stack);
+		std::optional<TokenMatchType> token;
+		bool accepted = run(handler, stack, token, read_tokens(false), throw_syntax_error, [](const TokenMatchType&) { return true; });
+		if (!accepted)
+			return std::nullopt;
+
+		return handler.get_result();
+	}
+
+	/**
+	 * Parses the input incrementally into concrete syntax tree using the tree of the input before the given edit. The tree
+	 * needs to come from parse_cst() or reparse_cst() of this parser. Input needs to contain the whole new text.
+	 *
+	 * Tokens before the edit are not read again, parser rather restores its state from the old tree and starts reading
+	 * tokens from the first one whose reading examined the edited text. Once it reads a token behind the edit which is the same as the token in the old tree
+	 * and the parser is in the same state as it was before that token, the rest of the old tree is reused.
+	 * Only a single input stream is supported.
+	 */
+	std::optional<CstType> reparse_cst(const CstType& old_cst, std::istream& input, const TextEdit& edit)
+	{
+		std::vector<std::size_t> old_tokens;
+		for (std::size_t i = 0; i < old_cst.size(); ++i)
+		{
+			if (old_cst[i].is_token())
+				old_tokens.push_back(i);
+		}
+
+		// Edit can change every token whose reading looked at the edited text, even if it ended before it (like failed match
+		// of unterminated comment), so we keep only the tokens preceding the first such token
+		auto first_damaged = static_cast<std::size_t>(std::find_if(old_tokens.begin(), old_tokens.end(), [&](auto index) {
+			return old_cst[index].offset + old_cst[index].length + old_cst[index].lookahead > edit.offset;
+		}) - old_tokens.begin());
+		if (first_damaged == 0)
+			return parse_cst(input);
+
+		auto last_kept = old_tokens[first_damaged - 1];
+		auto delta = static_cast<std::ptrdiff_t>(edit.inserted) - static_cast<std::ptrdiff_t>(edit.removed);
+
+		start_input(input, true);
+		_tokenizer.enter_state(std::string{old_cst.get_tokenizer_state(last_kept)});
+		_tokenizer.skip_input(old_cst[last_kept].offset + old_cst[last_kept].length);
+
+		auto old_stack = old_cst.get_stack(last_kept + 1);
+		pmr::vector<std::uint32_t> stack(old_stack.begin(), old_stack.end(), _memory_resource);
+		CstHandler handler(CstType{_memory_resource}, &_tokenizer, &stack);
+		handler.get_cst().append(old_cst, 0, last_kept + 1, 0);
+
+		std::optional<std::size_t> reused_from;
+		std::optional<TokenMatchType> pending_token;
+		bool accepted = run(handler, stack, pending_token, read_tokens(false), throw_syntax_error, [&](const TokenMatchType& token) {
+			if (token.offset < edit.offset + edit.inserted || token.symbol->is_end())
+				return true;
+
+			auto old_offset = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(token.offset) - delta);
+			auto itr = std::partition_point(old_tokens.begin(), old_tokens.end(), [&](auto index) {
+				return old_cst[index].offset < old_offset;
+			});
+			if (itr == old_tokens.begin() || itr == old_tokens.end())
+				return true;
+
+			const auto& old_token = old_cst[*itr];
+			if (old_token.offset != old_offset || old_token.symbol != token.symbol || old_token.length != token.match_length)
+				return true;
+
+			// Parser needs to be in the same state as it was before the old token, which is right after the preceding token was shifted
+			const auto& cst = handler.get_cst();
+			auto previous = *std::prev(itr);
+			if (cst.get_tokenizer_state(cst.size() - 1) != old_cst.get_tokenizer_state(previous))
+				return true;
+
+			auto previous_stack = old_cst.get_stack(previous + 1);
+			if (!std::equal(stack.begin(), stack.end(), previous_stack.begin(), previous_stack.end()))
+				return true;
+
+			reused_from = previous + 1;
+			return false;
+		});
+
+		if (reused_from)
+			handler.get_cst().append(old_cst, reused_from.value(), old_cst.size(), delta);
+		else if (!accepted)
+			return std::nullopt;
+
+		return handler.get_result();
+	}
+
+	/**
+	 * Parses the input into reduction log without performing actions of rules, so they can be performed later
+	 * (possibly in parallel) by evaluating the log. Actions of tokens are performed as usual except for lazy tokens,
+	 * whose lexemes refer to the input. Evaluate the log before parsing another input or retain the input
+	 * in such case. Syntax errors are thrown as in parse().
+	 */
+	std::optional<ReductionLogType> parse_log(std::istream& input)
+	{
+		start_input(input);
+
+		LogHandler handler(_memory_resource);
+		bool accepted = run(handler, true, throw_syntax_error);
+
+		if (!accepted)
+			return std::nullopt;
+
+		return handler.get_result();
+	}
+
+	/**
+	 * Checks whether the input is syntactically valid. Only the stack of states is maintained, so neither actions
+	 * of tokens (including global tokenizer action) nor actions of rules are performed. Tokenizer states therefore
+	 * can't be changed from actions of tokens during validation. Syntax errors are not thrown but returned
+	 * in the result together with the offset in the input where they happened.
+	 */
+	ValidationResultType validate(std::istream& input)
+	{
+		start_input(input);
+
+		ValidationResultType result{true, nullptr, 0, {}};
+		NoValueHandler handler;
+		run(handler, false, [&](const std::optional<TokenMatchType>& token, std::vector<const SymbolType*>&& expected_symbols) {
+			result = ValidationResultType{
+				false,
+				token ? token.value().symbol : nullptr,
+				token ? token.value().offset : _tokenizer.get_offset(),
+				std::move(expected_symbols)
+			};
+		});
+		return result;
+	}
+
+	std::string generate_automaton_graph()
+	{
+		return _automaton.generate_graph();
+	}
+
+	std::string generate_includes_relation_graph()
+	{
+		return _includes.generate_relation_graph();
+	}
+
+private:
+	/**
+	 * Records every shift and reduction into flat concrete syntax tree together with the states of the parser
+	 * and the tokenizer, so the tree can be later used for incremental reparsing.
+	 */
+	class CstHandler
+	{
+	public:
+		CstHandler(CstType&& cst, const TokenizerType* tokenizer, const pmr::vector<std::uint32_t>* stack) : _cst(std::move(cst)),
+			_tokenizer(tokenizer), _stack(stack) {}
+
+		CstType& get_cst()
+		{
+			return _cst;
+		}
+
+		void shift(TokenMatchType&& token)
+		{
+			auto end = token.offset + token.match_length;
+			auto lookahead_end = _tokenizer->get_lookahead_end();
+			_cst.add_token(token.symbol, token.offset, token.match_length, _stack->back(), lookahead_end > end ? lookahead_end - end : 0);
+			_cst.set_tokenizer_state(_tokenizer->get_state());
+		}
+
+		void reduce(const RuleType* rule)
+		{
+			_cst.add_reduction(rule, static_cast<std::uint32_t>(rule->get_rhs().size()), _stack->back());
+		}
+
+		void reset_value() {}
+
+		CstType get_result()
+		{
+			return std::move(_cst);
+		}
+
+	private:
+		CstType _cst;
+		const TokenizerType* _tokenizer;
+		const pmr::vector<std::uint32_t>* _stack;
+	};
 
+	/**
+	 * Records every shift and reduction into reduction log.
+	 */
+	class LogHandler
+	{
+	public:
+		LogHandler(pmr::memory_resource* resource) : _log(resource) {}
+
+		void shift(TokenMatchType&& token)
+		{
+			_log.add_token(std::move(token));
+		}
+
+		void reduce(const RuleType* rule)
+		{
+			_log.add_reduction(rule);
+		}
+
+		void reset_value()
+		{
+			_log.reset_value();
+		}
+
+		ReductionLogType get_result()
+		{
+			return std::move(_log);
+		}
+
+	private:
+		ReductionLogType _log;
+	};
+
+	/**
+	 * State of parsing started by start() which goes on step by step.
+	 */
+	struct Session
+	{
+		pmr::vector<std::uint32_t> stack;
+		ValueHandler<ValueT> values;
 		std::optional<TokenMatchType> token;
+		bool accepted;
+	};
+
+	/**
+	 * Ignores semantic values completely, used when the input is only validated.
+	 */
+	struct NoValueHandler
+	{
+		void shift(TokenMatchType&&) {}
+		void reduce(const RuleType*) {}
+		void reset_value() {}
+	};
+
+	static void throw_syntax_error(const std::optional<TokenMatchType>& token, std::vector<const SymbolType*>&& expected_symbols)
+	{
+		if (!token)
+			throw SyntaxError(expected_symbols);
+		throw SyntaxError(token.value().symbol, expected_symbols);
+	}
+
+	/**
+	 * Returns the token which parser needs to read first to parse from the given start symbol. Additional start symbols
+	 * are selected by their start marker, nothing needs to be read for the start symbol itself.
+	 */
+	std::optional<TokenMatchType> start_token(const std::string& start_symbol) const
+	{
+		const auto* symbol = _grammar.get_symbol(start_symbol);
+		assert(symbol && "Unknown start symbol");
+
+		if (symbol == _grammar.get_start_rule()->get_rhs()[0])
+			return std::nullopt;
+
+		const auto* marker = _grammar.get_start_marker(symbol);
+		assert(marker && "Symbol needs to be added as start symbol first");
+		return TokenMatchType{marker, ValueT{}, 0, 0};
+	}
+
+	void start_input(std::istream& input, bool track_lookahead = false)
+	{
+		_tokenizer.set_track_lookahead(track_lookahead);
+		_tokenizer.enter_state(std::string{decltype(_tokenizer)::DefaultState});
 		_tokenizer.clear_input_streams();
 		_tokenizer.push_input_stream(input);
+	}
+
+	/**
+	 * Runs LR parser over the input of the tokenizer. Parser itself keeps only the stack of states and leaves semantic
+	 * values to the handler, which is notified about every shift and reduction. Returns whether the input was accepted.
+	 * In case of syntax error, on_error is called with the unexpected token (or nothing if the input couldn't be tokenized)
+	 * and the symbols which were expected instead.
+	 */
+	template <typename HandlerT, typename ErrorF>
+	bool run(HandlerT& handler, bool perform_token_actions, ErrorF&& on_error)
+	{
+		pmr::vector<std::uint32_t> stack(1, 0, _memory_resource);
+		std::optional<TokenMatchType> token;
+		return run(handler, stack, token, read_tokens(perform_token_actions), std::forward<ErrorF>(on_error), [](const TokenMatchType&) { return true; });
+	}
+
+	template <typename TokensT>
+	std::optional<ValueT> parse_given_tokens(TokensT&& tokens, std::optional<TokenMatchType>&& token)
+	{
+		ValueHandler<ValueT> handler(_memory_resource);
+		pmr::vector<std::uint32_t> stack(1, 0, _memory_resource);
+		bool accepted = run(handler, stack, token, given_tokens(std::forward<TokensT>(tokens)), throw_syntax_error, [](const TokenMatchType&) { return true; });
+
+		if (!accepted)
+			return std::nullopt;
+
+		return handler.get_result();
+	}
+
+	/**
+	 * Returns source of the tokens for run() which takes them from the given range or function (see parse_tokens())
+	 * and which returns end of input symbol right after the last token.
+	 */
+	template <typename TokensT>
+	auto given_tokens(TokensT&& tokens)
+	{
+		auto make_token = [this, end_offset = std::size_t{0}](std::optional<TokenMatchType>&& token) mutable {
+			if (!token)
+				return std::optional<TokenMatchType>{TokenMatchType{_grammar.get_end_of_input_symbol(), ValueT{}, 0, end_offset}};
+
+			assert(token.value().symbol->is_terminal() && !token.value().symbol->is_start_marker() && "Tokens need to have terminal symbols");
+			end_offset = token.value().offset + token.value().match_length;
+			return std::move(token);
+		};
+
+		if constexpr (std::is_invocable_v<TokensT&>)
+		{
+			return [&tokens, make_token]() mutable {
+				return make_token(tokens());
+			};
+		}
+		else
+		{
+			return [&tokens, make_token, itr = std::begin(tokens)]() mutable {
+				if (itr == std::end(tokens))
+					return make_token(std::nullopt);
+
+				std::optional<TokenMatchType> token;
+				if constexpr (std::is_rvalue_reference_v<TokensT&&>)
+					token.emplace(std::move(*itr++));
+				else
+					token.emplace(*itr++);
+				return make_token(std::move(token));
+			};
+		}
+	}
 
-		std::deque<std::pair<std::uint32_t, std::optional<ValueT>>> stack;
-		stack.emplace_back(0, std::nullopt);
+	/**
+	 * Returns source of the tokens for run() which reads them from the tokenizer.
+	 */
+	auto read_tokens(bool perform_token_actions)
+	{
+		return [this, perform_token_actions]() {
+			return _tokenizer.next_token(perform_token_actions);
+		};
+	}
 
+	/**
+	 * Runs LR parser starting with the given stack of states, which is updated as the parser goes. State on top of the stack
+	 * is always pushed before the handler is notified about the shift or reduction which led to it. Tokens are read by calling
+	 * next_token, which returns nothing if the input couldn't be tokenized. Token is the token which was already read but not shifted
+	 * yet (if any). Function on_token is called with every new token before parser acts on it and the parser stops if it returns false.
+	 * Such token is then kept in token.
+	 */
+	template <typename HandlerT, typename NextTokenF, typename ErrorF, typename TokenF>
+	bool run(HandlerT& handler, pmr::vector<std::uint32_t>& stack, std::optional<TokenMatchType>& token, NextTokenF&& next_token,
+		ErrorF&& on_error, TokenF&& on_token)
+	{
 		while (!stack.empty())
 		{
 			// Check if we remember token from the last iteration because we did reduction
 			// so the token was not "consumed" from the input.
 			if (!token)
 			{
-				token = _tokenizer.next_token();
+				token = next_token();
 				if (!token)
 				{
-					auto expected_symbols = _parsing_table.get_expected_symbols_from_state(_automaton.get_state(stack.back().first));
-					throw SyntaxError(expected_symbols);
+					on_error(token, _parsing_table.get_expected_symbols_from_state(_automaton.get_state(stack.back())));
+					return false;
 				}
 
 				debug_parser("Tokenizer returned new token with symbol \'{}\'", token.value().symbol->get_name());
+				if (!on_token(token.value()))
+					return false;
 			}
 			else
 				debug_parser("Reusing old token with symbol \'{}\'", token.value().symbol->get_name());
 
-			debug_parser("Top of the stack is state {}", stack.back().first);
+			debug_parser("Top of the stack is state {}", stack.back());
 
 			const auto* next_symbol = token.value().symbol;
-			auto maybe_action = _parsing_table.get_action(_automaton.get_state(stack.back().first), next_symbol);
+			auto maybe_action = _parsing_table.get_action(_automaton.get_state(stack.back()), next_symbol);
 			if (!maybe_action)
 			{
-				auto expected_symbols = _parsing_table.get_expected_symbols_from_state(_automaton.get_state(stack.back().first));
-				throw SyntaxError(next_symbol, expected_symbols);
+				on_error(token, _parsing_table.get_expected_symbols_from_state(_automaton.get_state(stack.back())));
+				return false;
 			}
 
 			// TODO: use visit
@@ -178,70 +817,38 @@ public:
 				const auto& reduce = std::get<ReduceActionType>(action);
 				debug_parser("Reducing by rule \'{}\'", reduce.rule->to_string());
 
-				// Each symbol on right-hand side of the rule should have record on the stack
-				// We'll pop them out and put them in reverse order so user have them available
-				// left-to-right and not right-to-left.
-				std::vector<ValueT> action_arg;
-				action_arg.reserve(reduce.rule->get_number_of_required_arguments_for_action());
-				assert(stack.size() >= action_arg.capacity() && "Stack is too small");
-
-				for (std::size_t i = 0; i < action_arg.capacity(); ++i)
-				{
-					// Notice how std::move() is only around optional itself and not the whole expressions
-					// We need to do this in order to perform move together with value_or()
-					// See: https://en.cppreference.com/w/cpp/utility/optional/value_or
-					// std::move(*this) is performed only when value_or() is called from r-value
-					//
-					// Also do not pop from stack here because midrule actions can still return us arguments back
-					action_arg.insert(action_arg.begin(), std::move(stack[stack.size() - i - 1].second).value_or(ValueT{}));
-				}
-
 				// What left on the stack now determines what state we get into now
 				// We use size of RHS to determine stack top because midrule actions might have only borrowed something from stack so the
 				// real stack top is not the actual top. Midrule actions have 0 RHS size even though they borrow items. Other rules
 				// have same size of RHS and what they take out of stack.
-				auto maybe_next_state = _parsing_table.get_transition(_automaton.get_state(stack[stack.size() - reduce.rule->get_rhs().size() - 1].first), reduce.rule->get_lhs());
-				if (!maybe_next_state)
+				assert(stack.size() > reduce.rule->get_rhs().size() && "Stack is too small");
+				stack.resize(stack.size() - reduce.rule->get_rhs().size());
+				auto maybe_go_to = _parsing_table.get_transition(_automaton.get_state(stack.back()), reduce.rule->get_lhs());
+				if (!maybe_go_to)
 				{
 					assert(false && "Reduction happened but corresponding GOTO table record is empty");
-					return std::nullopt;
+					return false;
 				}
 
-				auto action_result = reduce.rule->has_action() ? reduce.rule->perform_action(std::move(action_arg)) : ValueT{};
+				const auto& go_to = maybe_go_to.value();
+				debug_parser("Pushing state {}", go_to.state->get_index());
+				stack.push_back(go_to.state->get_index());
 
-				// Midrule actions only borrowed arguments and it is returning them back
-				if (reduce.rule->is_midrule())
-				{
-					for (std::size_t i = 0; i < action_arg.size(); ++i)
-						stack[stack.size() - i - 1].second = std::move(action_arg[action_arg.size() - i - 1]);
-				}
-				// Non-midrule actions actually consumed those arguments so pop them out
-				else
-				{
-					for (std::size_t i = 0; i < action_arg.size(); ++i)
-						stack.pop_back();
-				}
+				handler.reduce(reduce.rule);
 
-				debug_parser("Pushing state {}", maybe_next_state.value()->get_index());
-
-				stack.emplace_back(
-					maybe_next_state.value()->get_index(),
-					std::move(action_result)
-				);
+				// If GOTO skipped some unit rules without action, the value would be reset by them
+				if (go_to.reset_value)
+					handler.reset_value();
 			}
 			else if (std::holds_alternative<ShiftActionType>(action))
 			{
 				const auto& shift = std::get<ShiftActionType>(action);
 				debug_parser("Shifting state {}", shift.state->get_index());
 
-				// Notice how std::move() is only around optional itself and not the whole expressions
-				// We need to do this in order to perform move together with value()
-				// See: https://en.cppreference.com/w/cpp/utility/optional/value
-				// Return by rvalue is performed only when value() is called from r-value
-				stack.emplace_back(
-					shift.state->get_index(),
-					std::move(token).value().value
-				);
+				stack.push_back(shift.state->get_index());
+				handler.shift(std::move(token).value());
+				if (shift.reset_value)
+					handler.reset_value();
 
 				// We did shift so the token value is moved onto stack, "forget" the token
 				token.reset();
@@ -249,29 +856,14 @@ public:
 			else if (std::holds_alternative<Accept>(action))
 			{
 				debug_parser("Accept");
-				// Notice how std::move() is only around optional itself and not the whole expressions
-				// We need to do this in order to perform move together with value()
-				// See: https://en.cppreference.com/w/cpp/utility/optional/value
-				// Return by rvalue is performed only when value() is called from r-value
-				return std::move(stack.back().second).value();
+				return true;
 			}
 		}
 
 		assert(false && "Stack was emptied too early");
-		return std::nullopt;
-	}
-
-	std::string generate_automaton_graph()
-	{
-		return _automaton.generate_graph();
+		return false;
 	}
 
-	std::string generate_includes_relation_graph()
-	{
-		return _includes.generate_relation_graph();
-	}
-
-private:
 	Grammar<ValueT> _grammar;
 	Tokenizer<ValueT> _tokenizer;
 	Automaton<ValueT> _automaton;
@@ -286,6 +878,9 @@ private:
 	std::vector<TokenBuilderType> _token_builders;
 
 	ParserReportType _report;
+	pmr::memory_resource* _memory_resource;
+	std::optional<Session> _session;
+	std::uint64_t _session_id;
 };
 
 } // namespace pog
@@ -68,6 +68,23 @@ public:
 		_issues.push_back(ReduceReduceConflictType{state, rule1, rule2});
 	}
 
+	/**
+	 * Symbols and rules which were pruned from the grammar because they are unproductive or unreachable
+	 * from the start symbol. They are not considered to be issues.
+	 */
+	const std::vector<const SymbolType*>& get_pruned_symbols() const { return _pruned_symbols; }
+	const std::vector<const RuleType*>& get_pruned_rules() const { return _pruned_rules; }
+
+	void add_pruned_symbol(const SymbolType* symbol)
+	{
+		_pruned_symbols.push_back(symbol);
+	}
+
+	void add_pruned_rule(const RuleType* rule)
+	{
+		_pruned_rules.push_back(rule);
+	}
+
 	std::string to_string(std::string_view arrow = "->", std::string_view eps = "<eps>") const
 	{
 		std::vector<std::string> issues_str(_issues.size());
@@ -82,6 +99,8 @@ public:
 
 private:
 	std::vector<IssueType> _issues;
+	std::vector<const SymbolType*> _pruned_symbols;
+	std::vector<const RuleType*> _pruned_rules;
 };
 
 } // namespace pog
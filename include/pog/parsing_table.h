@@ -1,9 +1,16 @@
 #pragma once
 
-#include <unordered_map>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 #include <pog/action.h>
 #include <pog/automaton.h>
+#include <pog/bitset.h>
 #include <pog/errors.h>
 #include <pog/grammar.h>
 #include <pog/parser_report.h>
@@ -12,9 +19,35 @@
 #include <pog/symbol.h>
 #include <pog/types/state_and_rule.h>
 #include <pog/types/state_and_symbol.h>
+#include <pog/utils.h>
 
 namespace pog {
 
+/**
+ * Specifies when rows of the parsing table are calculated.
+ */
+enum class TableConstruction
+{
+	Eager, ///< Whole parsing table is calculated during preparation of the parser
+	Lazy ///< Row of each state is calculated once parser enters the state for the first time
+};
+
+/**
+ * Parsing table consists of ACTION and GOTO table. Both are stored as rows per state of the
+ * LR automaton where each row is sorted by the index of the symbol.
+ *
+ * Chains of unit rules without actions (like E -> T, T -> F) are eliminated from the table.
+ * If the state entered through shift or GOTO would only reduce by such rule, the record is
+ * redirected to the state which the parser would get into after the reduction and the value
+ * is reset to default one as the reduction would do. This is done only if the skipped reduction
+ * is performed for every symbol which the next state expects, so syntax errors are still detected
+ * on the same symbol. The skipped state can however expect more symbols than the next state
+ * because of merged lookaheads of LALR, so the list of expected symbols can be more precise.
+ *
+ * When the table is calculated lazily, each row is calculated together with all the lookaheads
+ * it needs once it's requested for the first time. Calculated rows are never changed again so
+ * they can be read without any locking and only calculation of new rows is synchronized.
+ */
 template <typename ValueT>
 class ParsingTable
 {
@@ -22,9 +55,11 @@ public:
 	using ActionType = Action<ValueT>;
 	using ShiftActionType = Shift<ValueT>;
 	using ReduceActionType = Reduce<ValueT>;
+	using GotoType = Goto<ValueT>;
 
 	using AutomatonType = Automaton<ValueT>;
 	using GrammarType = Grammar<ValueT>;
+	using ParserReportType = ParserReport<ValueT>;
 	using RuleType = Rule<ValueT>;
 	using StateType = State<ValueT>;
 	using SymbolType = Symbol<ValueT>;
@@ -32,67 +67,283 @@ public:
 	using StateAndRuleType = StateAndRule<ValueT>;
 	using StateAndSymbolType = StateAndSymbol<ValueT>;
 
-	// TODO: Lookahead<> should be non-const but we need it for operator[]
-	ParsingTable(const AutomatonType* automaton, const GrammarType* grammar, Lookahead<ValueT>& lookahead_op)
-		: _automaton(automaton), _grammar(grammar), _lookahead_op(lookahead_op) {}
+	ParsingTable(const AutomatonType* automaton, const GrammarType* grammar, const Lookahead<ValueT>& lookahead_op)
+		: _automaton(automaton), _grammar(grammar), _rows(), _lazy(), _lookahead_op(lookahead_op) {}
 
-	void calculate(ParserReport<ValueT>& report)
+	void calculate(ParserReportType& report)
 	{
+		_lazy.reset();
+		_rows.assign(_automaton->get_states().size(), Row{});
 		for (const auto& state : _automaton->get_states())
+			calculate_row(report, state.get(), _rows[state->get_index()]);
+	}
+
+	void calculate_lazily()
+	{
+		_rows.assign(_automaton->get_states().size(), Row{});
+		_lazy = std::make_unique<LazyRows>();
+		_lazy->ready = std::make_unique<std::atomic<bool>[]>(_rows.size());
+	}
+
+	void add_accept(const StateType* state, const SymbolType* symbol)
+	{
+		add_accept(row_for_update(state), symbol);
+	}
+
+	void add_state_transition(ParserReportType& report, const StateType* src_state, const SymbolType* symbol, const StateType* dest_state)
+	{
+		add_state_transition(report, row_for_update(src_state), src_state, symbol, dest_state);
+	}
+
+	void add_reduction(ParserReportType& report, const StateType* state, const SymbolType* symbol, const RuleType* rule)
+	{
+		add_reduction(report, row_for_update(state), state, symbol, rule);
+	}
+
+	std::optional<ActionType> get_action(const StateType* state, const SymbolType* symbol) const
+	{
+		const auto& actions = get_row(state).actions;
+		auto itr = find_symbol(actions, symbol);
+		if (itr == actions.end())
+			return std::nullopt;
+
+		return itr->second;
+	}
+
+	std::optional<GotoType> get_transition(const StateType* state, const SymbolType* symbol) const
+	{
+		const auto& transitions = get_row(state).transitions;
+		auto itr = find_symbol(transitions, symbol);
+		if (itr == transitions.end())
+			return std::nullopt;
+
+		return itr->second;
+	}
+
+	std::vector<const SymbolType*> get_expected_symbols_from_state(const StateType* state) const
+	{
+		// Start markers are never read from the input so they are not expected by anyone
+		const auto& actions = get_row(state).actions;
+		std::vector<const SymbolType*> result;
+		transform_if(actions.begin(), actions.end(), std::back_inserter(result),
+			[](const auto& symbol_action) { return !symbol_action.first->is_start_marker(); },
+			[](const auto& symbol_action) { return symbol_action.first; }
+		);
+		return result;
+	}
+
+private:
+	struct Row
+	{
+		std::vector<std::pair<const SymbolType*, ActionType>> actions;
+		std::vector<std::pair<const SymbolType*, GotoType>> transitions;
+	};
+
+	struct LazyRows
+	{
+		std::mutex mutex;
+		std::unique_ptr<std::atomic<bool>[]> ready;
+	};
+
+	template <typename T>
+	static auto find_symbol(T& entries, const SymbolType* symbol)
+	{
+		auto itr = std::lower_bound(entries.begin(), entries.end(), symbol->get_index(), [](const auto& entry, auto needle) {
+			return entry.first->get_index() < needle;
+		});
+		if (itr != entries.end() && itr->first != symbol)
+			return entries.end();
+
+		return itr;
+	}
+
+	template <typename T, typename U>
+	static void insert_symbol(std::vector<std::pair<const SymbolType*, T>>& entries, const SymbolType* symbol, U&& value)
+	{
+		auto itr = std::lower_bound(entries.begin(), entries.end(), symbol->get_index(), [](const auto& entry, auto needle) {
+			return entry.first->get_index() < needle;
+		});
+		entries.emplace(itr, symbol, std::forward<U>(value));
+	}
+
+	Row& row_for_update(const StateType* state)
+	{
+		if (state->get_index() >= _rows.size())
+			_rows.resize(state->get_index() + 1);
+
+		return _rows[state->get_index()];
+	}
+
+	const Row& get_row(const StateType* state) const
+	{
+		static const Row empty_row;
+
+		auto index = state->get_index();
+		if (index >= _rows.size())
+			return empty_row;
+
+		if (_lazy && !_lazy->ready[index].load(std::memory_order_acquire))
 		{
-			if (state->is_accepting())
-				add_accept(state.get(), _grammar->get_end_of_input_symbol());
+			std::lock_guard<std::mutex> lock(_lazy->mutex);
+			if (!_lazy->ready[index].load(std::memory_order_relaxed))
+			{
+				// Conflicts are resolved in the same way as in eager calculation but they are
+				// not reported anywhere because preparation of the parser is already over
+				ParserReportType report;
+				calculate_row(report, state, _rows[index]);
+				_lazy->ready[index].store(true, std::memory_order_release);
+			}
+		}
+
+		return _rows[index];
+	}
+
+	void calculate_row(ParserReportType& report, const StateType* state, Row& row) const
+	{
+		if (state->is_accepting())
+			add_accept(row, _grammar->get_end_of_input_symbol());
+
+		for (const auto& [sym, dest_state] : state->get_transitions())
+			add_state_transition(report, row, state, sym, dest_state);
 
-			for (const auto& [sym, dest_state] : state->get_transitions())
-				add_state_transition(report, state.get(), sym, dest_state);
+		const auto& reductions = _automaton->get_reductions();
+		auto [first_reduction, last_reduction] = _automaton->get_reduction_ids(state);
+		for (auto reduction_id = first_reduction; reduction_id < last_reduction; ++reduction_id)
+		{
+			const auto* rule = reductions[reduction_id].rule;
+			for (auto sym_index : _lookahead_op[reduction_id])
+				add_reduction(report, row, state, _grammar->get_symbols()[sym_index].get(), rule);
+		}
 
-			for (const auto& item : state->get_production_items())
+		for (auto& [sym, action] : row.actions)
+		{
+			if (auto* shift = std::get_if<ShiftActionType>(&action))
 			{
-				for (const auto& sym : _lookahead_op[StateAndRuleType{state.get(), item->get_rule()}])
-					add_reduction(report, state.get(), sym, item->get_rule());
+				if (auto bypass_state = bypass_unit_rules(state, shift->state))
+					*shift = ShiftActionType{bypass_state.value(), true};
 			}
 		}
+
+		for (auto& [sym, go_to] : row.transitions)
+		{
+			if (auto bypass_state = bypass_unit_rules(state, go_to.state))
+				go_to = GotoType{bypass_state.value(), true};
+		}
 	}
 
-	void add_accept(const StateType* state, const SymbolType* symbol)
+	/**
+	 * Returns the id of the reduction if the only thing the state can do is to reduce by unit rule
+	 * without action and sink.
+	 */
+	std::optional<std::uint32_t> get_unit_reduction(const StateType* state) const
+	{
+		if (state->is_accepting() || !state->get_transitions().empty())
+			return std::nullopt;
+
+		auto [first_reduction, last_reduction] = _automaton->get_reduction_ids(state);
+		if (last_reduction - first_reduction != 1)
+			return std::nullopt;
+
+		const auto* rule = _automaton->get_reductions()[first_reduction].rule;
+		if (rule->get_rhs().size() != 1 || rule->has_action() || rule->has_sink() || rule->is_start_rule())
+			return std::nullopt;
+
+		return first_reduction;
+	}
+
+	/**
+	 * Returns set of symbols which have some action in ACTION table of the given state.
+	 */
+	Bitset get_action_symbols(const StateType* state) const
+	{
+		Bitset result{_grammar->get_symbols().size()};
+		if (state->is_accepting())
+			result.set(_grammar->get_end_of_input_symbol()->get_index());
+
+		for (const auto& [sym, dest_state] : state->get_transitions())
+		{
+			if (sym->is_terminal())
+				result.set(sym->get_index());
+		}
+
+		auto [first_reduction, last_reduction] = _automaton->get_reduction_ids(state);
+		for (auto reduction_id = first_reduction; reduction_id < last_reduction; ++reduction_id)
+			result |= _lookahead_op[reduction_id];
+
+		return result;
+	}
+
+	/**
+	 * Follows reductions by unit rules without action which would be performed right after
+	 * entering dest_state from src_state. Returns the state where the parser ends up or nothing
+	 * if there is no such reduction to skip.
+	 */
+	std::optional<const StateType*> bypass_unit_rules(const StateType* src_state, const StateType* dest_state) const
+	{
+		std::optional<const StateType*> result;
+
+		// Each skipped reduction leads to another transition of source state so we can't ever do more steps
+		// than that unless the unit rules are cyclic
+		const auto& src_transitions = src_state->get_transitions();
+		for (std::size_t steps = 0; steps < src_transitions.size(); ++steps)
+		{
+			auto reduction_id = get_unit_reduction(dest_state);
+			if (!reduction_id)
+				break;
+
+			// Reduction pops just dest_state out of the stack so GOTO is performed from src_state
+			auto itr = src_transitions.find(_automaton->get_reductions()[reduction_id.value()].rule->get_lhs());
+			if (itr == src_transitions.end())
+				break;
+
+			// Symbol which the next state expects but the reduction doesn't would be accepted
+			// by skipping the reduction even though the original parser would report syntax error
+			if (!get_action_symbols(itr->second).is_subset_of(_lookahead_op[reduction_id.value()]))
+				break;
+
+			dest_state = itr->second;
+			result = dest_state;
+		}
+
+		return result;
+	}
+
+	static void add_accept(Row& row, const SymbolType* symbol)
 	{
-		auto ss = StateAndSymbolType{state, symbol};
-		auto itr = _action_table.find(ss);
-		if (itr != _action_table.end())
+		auto itr = find_symbol(row.actions, symbol);
+		if (itr != row.actions.end())
 			assert(false && "Conflict happened in placing accept but this shouldn't happen");
 
-		_action_table.emplace(std::move(ss), Accept{});
+		insert_symbol(row.actions, symbol, Accept{});
 	}
 
-	void add_state_transition(ParserReport<ValueT>& report, const StateType* src_state, const SymbolType* symbol, const StateType* dest_state)
+	static void add_state_transition(ParserReportType& report, Row& row, const StateType* src_state, const SymbolType* symbol, const StateType* dest_state)
 	{
-		auto ss = StateAndSymbolType{src_state, symbol};
 		if (symbol->is_terminal())
 		{
-			auto itr = _action_table.find(ss);
-			if (itr != _action_table.end())
+			auto itr = find_symbol(row.actions, symbol);
+			if (itr != row.actions.end())
 			{
 				if (std::holds_alternative<ReduceActionType>(itr->second))
-					report.add_shift_reduce_conflict(ss.state, ss.symbol, std::get<ReduceActionType>(itr->second).rule);
+					report.add_shift_reduce_conflict(src_state, symbol, std::get<ReduceActionType>(itr->second).rule);
 			}
 			else
-				_action_table.emplace(std::move(ss), ShiftActionType{dest_state});
+				insert_symbol(row.actions, symbol, ShiftActionType{dest_state, false});
 		}
 		else if (symbol->is_nonterminal())
 		{
-			auto itr = _goto_table.find(ss);
-			if (itr != _goto_table.end())
+			auto itr = find_symbol(row.transitions, symbol);
+			if (itr != row.transitions.end())
 				assert(false && "Conflict happened in filling GOTO table but this shouldn't happen");
 
-			_goto_table.emplace(std::move(ss), dest_state);
+			insert_symbol(row.transitions, symbol, GotoType{dest_state, false});
 		}
 	}
 
-	void add_reduction(ParserReport<ValueT>& report, const StateType* state, const SymbolType* symbol, const RuleType* rule)
+	static void add_reduction(ParserReportType& report, Row& row, const StateType* state, const SymbolType* symbol, const RuleType* rule)
 	{
-		auto ss = StateAndSymbolType{state, symbol};
-		auto itr = _action_table.find(ss);
-		if (itr != _action_table.end())
+		auto itr = find_symbol(row.actions, symbol);
+		if (itr != row.actions.end())
 		{
 			std::optional<Precedence> stack_prec;
 			if (rule->has_precedence())
@@ -117,54 +368,19 @@ public:
 			}
 
 			if (std::holds_alternative<ReduceActionType>(itr->second))
-				report.add_reduce_reduce_conflict(ss.state, std::get<ReduceActionType>(itr->second).rule, rule);
+				report.add_reduce_reduce_conflict(state, std::get<ReduceActionType>(itr->second).rule, rule);
 			else if (std::holds_alternative<ShiftActionType>(itr->second))
-				report.add_shift_reduce_conflict(ss.state, ss.symbol, rule);
+				report.add_shift_reduce_conflict(state, symbol, rule);
 		}
 		else
-			_action_table.emplace(std::move(ss), ReduceActionType{rule});
-	}
-
-	std::optional<ActionType> get_action(const StateType* state, const SymbolType* symbol) const
-	{
-		auto action_itr = _action_table.find(StateAndSymbolType{state, symbol});
-		if (action_itr == _action_table.end())
-			return std::nullopt;
-
-		return action_itr->second;
-	}
-
-	std::optional<const StateType*> get_transition(const StateType* state, const SymbolType* symbol) const
-	{
-		auto goto_itr = _goto_table.find(StateAndSymbolType{state, symbol});
-		if (goto_itr == _goto_table.end())
-			return std::nullopt;
-
-		return goto_itr->second;
+			insert_symbol(row.actions, symbol, ReduceActionType{rule});
 	}
 
-	std::vector<const SymbolType*> get_expected_symbols_from_state(const StateType* state) const
-	{
-		std::vector<const SymbolType*> result;
-		for (const auto& sym : _grammar->get_symbols())
-		{
-			if (sym->is_nonterminal())
-				continue;
-
-			StateAndSymbolType ss{state, sym.get()};
-			if (auto itr = _action_table.find(ss); itr != _action_table.end())
-				result.push_back(sym.get());
-		}
-
-		return result;
-	}
-
-private:
 	const AutomatonType* _automaton;
 	const GrammarType* _grammar;
-	std::unordered_map<StateAndSymbolType, ActionType> _action_table;
-	std::unordered_map<StateAndSymbolType, const StateType*> _goto_table;
-	Lookahead<ValueT>& _lookahead_op;
+	mutable std::vector<Row> _rows;
+	std::unique_ptr<LazyRows> _lazy;
+	const Lookahead<ValueT>& _lookahead_op;
 };
 
 } // namespace pog
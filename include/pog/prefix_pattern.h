@@ -0,0 +1,325 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h>
+
+namespace pog {
+
+/**
+ * Builds regular expression which matches all prefixes of the strings matched by the given regular expression. The longest match
+ * of it at the start of the input therefore tells how much of the input the original regular expression can read before it fails.
+ *
+ * Result can match more than only the prefixes (assertions like \b or $ are left out and bounded repetitions become unbounded),
+ * but never less. Returns nothing for expressions it doesn't understand.
+ */
+class PrefixPatternBuilder
+{
+public:
+	PrefixPatternBuilder(std::string_view pattern) : _pattern(pattern), _pos(0), _error(false) {}
+
+	std::optional<std::string> build()
+	{
+		auto result = alternation();
+		if (_error || _pos != _pattern.size())
+			return std::nullopt;
+
+		return std::move(result.prefix);
+	}
+
+private:
+	/**
+	 * Regular expression of the part of the pattern (with assertions left out) together with the expression matching its prefixes.
+	 * Prefixes of the single character are just the empty string.
+	 */
+	struct Part
+	{
+		std::string full;
+		std::string prefix;
+		bool zero_width;
+	};
+
+	bool at_end() const { return _pos == _pattern.size(); }
+	char peek() const { return _pattern[_pos]; }
+
+	Part alternation()
+	{
+		auto result = concatenation();
+		while (!_error && !at_end() && peek() == '|')
+		{
+			++_pos;
+			auto branch = concatenation();
+			result.full += "|" + branch.full;
+			result.prefix += "|" + branch.prefix;
+		}
+
+		return result;
+	}
+
+	Part concatenation()
+	{
+		std::vector<Part> parts;
+		while (!_error && !at_end() && peek() != '|' && peek() != ')')
+		{
+			if (_pattern.substr(_pos, 2) == "\\Q")
+				quoted(parts);
+			else
+				parts.push_back(atom());
+
+			if (!_error && !parts.empty())
+				repetition(parts.back());
+		}
+
+		// Prefix of A B C is either prefix of A or A followed by prefix of B C
+		Part result{std::string{}, std::string{}, false};
+		for (auto itr = parts.rbegin(); itr != parts.rend(); ++itr)
+		{
+			if (itr->zero_width)
+				continue;
+
+			result.prefix = fmt::format("(?:{}|{}{})", itr->prefix, itr->full, result.prefix);
+		}
+		for (const auto& part : parts)
+			result.full += part.full;
+
+		return result;
+	}
+
+	void repetition(Part& part)
+	{
+		bool repeated = false;
+		while (!at_end())
+		{
+			auto length = repetition_length();
+			if (length == 0)
+				break;
+
+			_pos += length;
+			if (!at_end() && peek() == '?')
+				++_pos;
+			repeated = true;
+		}
+
+		if (!repeated || part.zero_width)
+			return;
+
+		// Prefix of repetition of A is any number of A followed by prefix of A
+		part.prefix = fmt::format("(?:{})*{}", part.full, part.prefix);
+		part.full = fmt::format("(?:{})*", part.full);
+	}
+
+	std::size_t repetition_length() const
+	{
+		if (peek() == '*' || peek() == '+' || peek() == '?')
+			return 1;
+		else if (peek() != '{')
+			return 0;
+
+		// Braces which don't form repetition like {2,5} are just literal characters
+		auto end = _pattern.find('}', _pos);
+		if (end == std::string_view::npos || end == _pos + 1)
+			return 0;
+
+		auto bounds = _pattern.substr(_pos + 1, end - _pos - 1);
+		auto comma = bounds.find(',');
+		if (comma == 0 || bounds.find_first_not_of("0123456789,") != std::string_view::npos || bounds.find(',', comma + 1) != std::string_view::npos)
+			return 0;
+
+		return end - _pos + 1;
+	}
+
+	void quoted(std::vector<Part>& parts)
+	{
+		_pos += 2;
+		auto end = _pattern.find("\\E", _pos);
+		auto text = _pattern.substr(_pos, end == std::string_view::npos ? std::string_view::npos : end - _pos);
+		_pos += text.size() + (end == std::string_view::npos ? 0 : 2);
+
+		for (std::size_t i = 0; i < text.size();)
+		{
+			auto length = character_length(text, i);
+			parts.push_back(Part{literal(text.substr(i, length)), std::string{}, false});
+			i += length;
+		}
+	}
+
+	Part atom()
+	{
+		auto start = _pos;
+		switch (peek())
+		{
+			case '(':
+				return group();
+			case '[':
+				skip_class();
+				return character(start);
+			case '\\':
+				return escape();
+			case '^':
+			case '$':
+				++_pos;
+				return Part{std::string{}, std::string{}, true};
+			case '*':
+			case '+':
+			case '?':
+				_error = true;
+				return Part{};
+			case '{':
+				++_pos;
+				return Part{"\\{", std::string{}, false};
+			default:
+				_pos += character_length(_pattern, _pos);
+				return character(start);
+		}
+	}
+
+	Part group()
+	{
+		++_pos;
+		std::string flags;
+		if (!at_end() && peek() == '?')
+		{
+			++_pos;
+			if (_pattern.substr(_pos, 2) == "P<" || (!at_end() && peek() == '<'))
+			{
+				auto end = _pattern.find('>', _pos);
+				if (end == std::string_view::npos)
+				{
+					_error = true;
+					return Part{};
+				}
+				_pos = end + 1;
+			}
+			else
+			{
+				auto end = _pattern.find_first_not_of("imsU-", _pos);
+				// Flags without group change the rest of the enclosing group and we don't track that
+				if (end == std::string_view::npos || _pattern[end] != ':')
+				{
+					_error = true;
+					return Part{};
+				}
+				flags = std::string{_pattern.substr(_pos, end - _pos)};
+				_pos = end + 1;
+			}
+		}
+
+		auto inner = alternation();
+		if (_error || at_end() || peek() != ')')
+		{
+			_error = true;
+			return Part{};
+		}
+		++_pos;
+
+		return Part{fmt::format("(?{}:{})", flags, inner.full), fmt::format("(?{}:{})", flags, inner.prefix), false};
+	}
+
+	Part escape()
+	{
+		auto start = _pos++;
+		if (at_end())
+		{
+			_error = true;
+			return Part{};
+		}
+
+		auto c = peek();
+		if (c == 'b' || c == 'B' || c == 'A' || c == 'z')
+		{
+			++_pos;
+			return Part{std::string{}, std::string{}, true};
+		}
+		else if ((c == 'x' || c == 'p' || c == 'P') && _pattern.substr(_pos + 1, 1) == "{")
+		{
+			auto end = _pattern.find('}', _pos);
+			if (end == std::string_view::npos)
+			{
+				_error = true;
+				return Part{};
+			}
+			_pos = end + 1;
+		}
+		else if (c == 'x')
+			_pos = std::min(_pos + 3, _pattern.size());
+		else if (c == 'p' || c == 'P')
+			_pos = std::min(_pos + 2, _pattern.size());
+		else if (c >= '0' && c <= '7')
+		{
+			auto end = std::min(_pattern.find_first_not_of("01234567", _pos), std::min(_pos + 3, _pattern.size()));
+			_pos = end;
+		}
+		else
+			_pos += character_length(_pattern, _pos);
+
+		return character(start);
+	}
+
+	void skip_class()
+	{
+		++_pos;
+		if (!at_end() && peek() == '^')
+			++_pos;
+		// Closing bracket right at the start is literal
+		if (!at_end() && peek() == ']')
+			++_pos;
+
+		while (!at_end() && peek() != ']')
+		{
+			if (peek() == '\\')
+				_pos += 2;
+			else if (_pattern.substr(_pos, 2) == "[:")
+			{
+				auto end = _pattern.find(":]", _pos + 2);
+				_pos = end == std::string_view::npos ? _pattern.size() : end + 2;
+			}
+			else
+				++_pos;
+		}
+
+		if (_pos >= _pattern.size())
+		{
+			_error = true;
+			_pos = _pattern.size();
+			return;
+		}
+		++_pos;
+	}
+
+	Part character(std::size_t start) const
+	{
+		return Part{std::string{_pattern.substr(start, _pos - start)}, std::string{}, false};
+	}
+
+	static std::string literal(std::string_view c)
+	{
+		auto byte = static_cast<unsigned char>(c[0]);
+		bool plain = (byte >= '0' && byte <= '9') || (byte >= 'a' && byte <= 'z') || (byte >= 'A' && byte <= 'Z') || byte >= 0x80;
+		return plain ? std::string{c} : fmt::format("\\x{{{:02X}}}", byte);
+	}
+
+	/**
+	 * Length of UTF-8 character at the given position.
+	 */
+	static std::size_t character_length(std::string_view str, std::size_t pos)
+	{
+		auto byte = static_cast<unsigned char>(str[pos]);
+		std::size_t length = byte >= 0xF0 ? 4 : byte >= 0xE0 ? 3 : byte >= 0xC0 ? 2 : 1;
+		return std::min(length, str.size() - pos);
+	}
+
+	std::string_view _pattern;
+	std::size_t _pos;
+	bool _error;
+};
+
+inline std::optional<std::string> prefix_pattern(std::string_view pattern)
+{
+	return PrefixPatternBuilder{pattern}.build();
+}
+
+} // namespace pog
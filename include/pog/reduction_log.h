@@ -0,0 +1,222 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include <pog/memory_resource.h>
+#include <pog/rule.h>
+#include <pog/tokenizer.h>
+#include <pog/value_handler.h>
+
+namespace pog {
+
+/**
+ * Log of shifts and reductions performed by the parser which allows to perform actions of the rules later
+ * and separately from parsing. Entries are stored in post-order just like in Cst, so every entry comes right
+ * after the entries of its subtree. Tokens are stored together with their values (or lexemes if they are lazy).
+ */
+template <typename ValueT>
+class ReductionLog
+{
+public:
+	using RuleType = Rule<ValueT>;
+	using TokenMatchType = TokenMatch<ValueT>;
+	using ValueHandlerType = ValueHandler<ValueT>;
+
+	struct Entry
+	{
+		const RuleType* rule; ///< Reduced rule, nullptr for shifted tokens
+		std::uint32_t token; ///< Index of the shifted token
+		std::uint32_t subtree_size; ///< Number of entries in the subtree of this entry including the entry itself
+		bool reset_value; ///< Value is reset after this entry because parsing table skipped unit rule without action
+	};
+
+	ReductionLog(pmr::memory_resource* resource = pmr::get_default_resource()) : _resource(resource), _entries(resource), _tokens(resource) {}
+
+	std::size_t size() const { return _entries.size(); }
+	bool empty() const { return _entries.empty(); }
+	const Entry& operator[](std::size_t index) const { return _entries[index]; }
+	const pmr::vector<Entry>& get_entries() const { return _entries; }
+	const pmr::vector<TokenMatchType>& get_tokens() const { return _tokens; }
+
+	void add_token(TokenMatchType&& token)
+	{
+		_entries.push_back(Entry{nullptr, static_cast<std::uint32_t>(_tokens.size()), 1, false});
+		_tokens.push_back(std::move(token));
+	}
+
+	void add_reduction(const RuleType* rule)
+	{
+		std::uint32_t subtree_size = 1;
+		for (std::size_t i = 0; i < rule->get_rhs().size(); ++i)
+		{
+			assert(_entries.size() >= subtree_size && "Not enough subtrees for the reduction. This shouldn't happen");
+			subtree_size += _entries[_entries.size() - subtree_size].subtree_size;
+		}
+
+		_entries.push_back(Entry{rule, 0, subtree_size, false});
+	}
+
+	void reset_value()
+	{
+		_entries.back().reset_value = true;
+	}
+
+	/**
+	 * Performs actions of all rules in the log and returns the value of the start symbol. Values of tokens are moved
+	 * out of the log, so it can be evaluated only once.
+	 *
+	 * With more than one thread, independent subtrees are evaluated in parallel and only the rest of the tree is evaluated
+	 * on the calling thread once they are all done. Actions of rules and lazy tokens therefore need to be safe to call concurrently.
+	 * Subtrees which contain midrule actions or sinks or come after them are never evaluated in parallel, so midrule actions and sinks
+	 * are all performed in input order on the calling thread and all actions which follow them see their side effects.
+	 */
+	ValueT evaluate(std::size_t threads = 1)
+	{
+		assert(!empty() && "Evaluation of empty reduction log");
+
+		std::vector<std::size_t> tasks;
+		std::vector<std::optional<ValueT>> results;
+		if (threads > 1)
+		{
+			tasks = select_tasks(threads);
+			results.resize(tasks.size());
+			run_tasks(tasks, results, threads);
+		}
+
+		ValueHandlerType handler(_resource);
+		std::size_t next_task = 0;
+		for (std::size_t i = 0; i < _entries.size();)
+		{
+			// Subtree which was already evaluated in parallel is replaced by its value
+			if (next_task < tasks.size() && subtree_begin(tasks[next_task]) == i)
+			{
+				handler.push(std::move(results[next_task]).value());
+				i = tasks[next_task++] + 1;
+			}
+			else
+				replay(handler, i++);
+		}
+
+		return handler.get_result();
+	}
+
+private:
+	std::size_t subtree_begin(std::size_t root) const
+	{
+		return root + 1 - _entries[root].subtree_size;
+	}
+
+	void replay(ValueHandlerType& handler, std::size_t index)
+	{
+		const auto& entry = _entries[index];
+		if (entry.rule)
+			handler.reduce(entry.rule);
+		else
+			handler.shift(std::move(_tokens[entry.token]));
+
+		if (entry.reset_value)
+			handler.reset_value();
+	}
+
+	/**
+	 * Selects disjoint subtrees which can be evaluated in parallel and returns their roots sorted by their position in the log.
+	 * Subtrees are split into children until they are small enough so there are more of them than threads and threads can
+	 * balance the work. Tasks are all performed before the rest of the log, so only subtrees which don't have any midrule
+	 * or sink entry before their end can be selected.
+	 */
+	std::vector<std::size_t> select_tasks(std::size_t threads) const
+	{
+		// Number of midrule and sink entries before each entry, so we can tell whether subtree contains or follows any in constant time
+		std::vector<std::uint32_t> sequential(_entries.size() + 1, 0);
+		for (std::size_t i = 0; i < _entries.size(); ++i)
+		{
+			const auto* rule = _entries[i].rule;
+			sequential[i + 1] = sequential[i] + (rule && (rule->is_midrule() || rule->has_sink()) ? 1 : 0);
+		}
+
+		auto grain = std::max<std::size_t>(_entries.size() / (threads * 8), 1);
+
+		std::vector<std::size_t> tasks;
+		std::vector<std::size_t> pending{_entries.size() - 1};
+		while (!pending.empty())
+		{
+			auto root = pending.back();
+			pending.pop_back();
+
+			// Nothing in the subtree after midrule or sink entry can be evaluated before it
+			if (sequential[subtree_begin(root)] > 0)
+				continue;
+
+			const auto& entry = _entries[root];
+			if (entry.subtree_size <= grain || !entry.rule)
+			{
+				// Evaluating single token separately isn't worth it
+				if (sequential[root + 1] == 0 && entry.subtree_size > 1)
+					tasks.push_back(root);
+				continue;
+			}
+
+			auto child = root;
+			for (std::size_t i = 0; i < entry.rule->get_rhs().size(); ++i)
+			{
+				--child;
+				pending.push_back(child);
+				child -= _entries[child].subtree_size - 1;
+			}
+		}
+
+		std::sort(tasks.begin(), tasks.end());
+		return tasks;
+	}
+
+	void run_tasks(const std::vector<std::size_t>& tasks, std::vector<std::optional<ValueT>>& results, std::size_t threads)
+	{
+		std::atomic<std::size_t> next_task{0};
+		std::vector<std::exception_ptr> errors(threads);
+
+		auto worker = [&](std::size_t id) {
+			try
+			{
+				// Memory resource doesn't need to be thread-safe so stacks of the workers don't use it
+				for (auto task = next_task++; task < tasks.size(); task = next_task++)
+				{
+					ValueHandlerType handler;
+					for (auto i = subtree_begin(tasks[task]); i <= tasks[task]; ++i)
+						replay(handler, i);
+					results[task].emplace(handler.get_result());
+				}
+			}
+			catch (...)
+			{
+				errors[id] = std::current_exception();
+				next_task = tasks.size();
+			}
+		};
+
+		std::vector<std::thread> workers;
+		for (std::size_t id = 1; id < threads; ++id)
+			workers.emplace_back(worker, id);
+		worker(0);
+		for (auto& thread : workers)
+			thread.join();
+
+		for (const auto& error : errors)
+		{
+			if (error)
+				std::rethrow_exception(error);
+		}
+	}
+
+	pmr::memory_resource* _resource;
+	pmr::vector<Entry> _entries;
+	pmr::vector<TokenMatchType> _tokens;
+};
+
+} // namespace pog
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cassert>
+#include <unordered_set>
+
 #include <pog/relations/relation.h>
 #include <pog/types/state_and_symbol.h>
 
@@ -21,16 +24,19 @@ namespace pog {
  *
  * This is useful for construction of Follow sets because if b can be completely empty, then
  * what can follow A can also follow B (with respect to states they are in).
+ *
+ * Tuples (q,x) are represented by ids of nonterminal transitions assigned by the automaton.
  */
 template <typename ValueT>
-class Includes : public Relation<ValueT, StateAndSymbol<ValueT>>
+class Includes : public Relation<ValueT>
 {
 public:
-	using Parent = Relation<ValueT, StateAndSymbol<ValueT>>;
+	using Parent = Relation<ValueT>;
 
 	using AutomatonType = Automaton<ValueT>;
 	using BacktrackingInfoType = BacktrackingInfo<ValueT>;
 	using GrammarType = Grammar<ValueT>;
+	using ItemType = Item<ValueT>;
 	using StateType = State<ValueT>;
 	using SymbolType = Symbol<ValueT>;
 
@@ -42,87 +48,55 @@ public:
 
 	virtual void calculate() override
 	{
+		std::vector<std::pair<std::uint32_t, std::uint32_t>> edges;
+
 		// Iterate over all states in the LR automaton
 		for (const auto& state : Parent::_automaton->get_states())
 		{
 			for (const auto& item : *state.get())
 			{
 				// We are looking for items in form A -> a <*> B b so we are not intersted in final items
-				if (item->is_final())
+				if (item.is_final())
 					continue;
 
 				// Get the symbol right next to <*> in an item
-				auto next_symbol = item->get_read_symbol();
+				auto next_symbol = item.get_read_symbol();
 
 				// If the next symbol is not nonterminal then we are again not interested
 				if (!next_symbol->is_nonterminal())
 					continue;
 
-				StateAndSymbolType src_ss{state.get(), next_symbol};
-				Parent::_relation.emplace(src_ss, std::unordered_set<StateAndSymbolType>{});
+				auto src_id = Parent::_automaton->get_nonterminal_transition_id(state.get(), next_symbol);
+				assert(src_id && "Nonterminal transition is not numbered. This shouldn't happen");
 
 				// Get the 'b' out of A -> a <*> B b
 				// If b can't be reduced down to empty string - Empty(b) - then we are not interested
-				auto right_rest = item->get_right_side_without_read_symbol();
+				auto right_rest = item.get_right_side_without_read_symbol();
 				if (!right_rest.empty() && !Parent::_grammar->empty(right_rest))
 					continue;
 
-				// Now we'll start backtracking through LR automaton using backtransitions.
-				// We'll basically just go in the different direction of arrows in the automata.
-				// We know of what symbols 'a' in A -> a <*> B b is made of so we exactly know which
-				// backtransitions to take. There can be multiple transitions through the same symbol
-				// going into current state so we'll put them into queue and process until queue is empty.
-				std::unordered_set<const StateType*> visited_states;
-				std::deque<BacktrackingInfoType> to_process;
-				// Let's insert the current state and item A -> a <*> B b into the queue as a starting point
-				to_process.push_back(BacktrackingInfoType{state.get(), *item.get()});
-				while (!to_process.empty())
-				{
-					auto backtracking_info = std::move(to_process.front());
-					to_process.pop_front();
-
-					// If we've reached state with item A -> <*> a B b, we've reached our destination
-					if (backtracking_info.item.get_read_pos() == 0)
-					{
-						// Insert relation
-						StateAndSymbolType dest_ss{backtracking_info.state, backtracking_info.item.get_rule()->get_lhs()};
-						auto itr = Parent::_relation.find(src_ss);
-						if (itr == Parent::_relation.end())
-							assert(false && "This shouldn't happen");
-						itr->second.insert(std::move(dest_ss));
-						continue;
-					}
-
-					// Observe backtransitions over the symbol left to the <*> in an item
-					const auto& back_trans = backtracking_info.state->get_back_transitions();
-					auto itr = back_trans.find(backtracking_info.item.get_previous_symbol());
-					if (itr == back_trans.end())
-						assert(false && "This shouldn't happen");
-
-					// Perform step back of an item so that <*> in an item is moved one symbol to the left
-					backtracking_info.item.step_back();
-					for (const auto& dest_state : itr->second)
-					{
-						if (visited_states.find(dest_state) == visited_states.end())
-						{
-							// Put non-visited states from backtransitions into the queue
-							to_process.push_back(BacktrackingInfoType{dest_state, backtracking_info.item});
-							visited_states.emplace(dest_state);
-						}
-					}
-				}
+				// Find all (P, A) such that state P contains item A -> <*> a B b
+				backtrack(state.get(), item, [&](std::uint32_t dest_id) {
+					edges.emplace_back(src_id.value(), dest_id);
+				});
 			}
 		}
+
+		Parent::build(Parent::_automaton->get_nonterminal_transitions().size(), std::move(edges));
 	}
 
 	std::string generate_relation_graph()
 	{
+		const auto& transitions = Parent::_automaton->get_nonterminal_transitions();
+
 		std::vector<std::string> states_str, edges_str;
-		for (const auto& [ss, dests] : Parent::_relation)
+		for (std::uint32_t id = 0; id < Parent::size(); ++id)
 		{
+			const auto& ss = transitions[id];
 			states_str.push_back(fmt::format("n_{}_{} [label=\"({}, {})\"]", ss.state->get_index(), ss.symbol->get_index(), ss.state->get_index(), ss.symbol->get_name()));
-			for (const auto& dest_ss : dests)
+			for (auto dest_id : (*this)[id])
 			{
+				const auto& dest_ss = transitions[dest_id];
 				states_str.push_back(fmt::format("n_{}_{} [label=\"({}, {})\"]", dest_ss.state->get_index(), dest_ss.symbol->get_index(), dest_ss.state->get_index(), dest_ss.symbol->get_name()));
 				edges_str.push_back(fmt::format("n_{}_{} -> n_{}_{}", ss.state->get_index(), ss.symbol->get_index(), dest_ss.state->get_index(), dest_ss.symbol->get_index()));
 			}
@@ -139,6 +113,79 @@ node [shape=circle];
 			fmt::join(edges_str.begin(), edges_str.end(), "\n")
 		);
 	}
+
+protected:
+	virtual std::size_t node_count() const override
+	{
+		return Parent::_automaton->get_nonterminal_transitions().size();
+	}
+
+	virtual void collect(std::uint32_t node, std::vector<std::uint32_t>& targets) const override
+	{
+		// Only items A -> a <*> B b where B is the symbol of the transition are interesting
+		const auto& ss = Parent::_automaton->get_nonterminal_transitions()[node];
+		for (const auto& item : *ss.state)
+		{
+			if (item.get_read_symbol() != ss.symbol)
+				continue;
+
+			auto right_rest = item.get_right_side_without_read_symbol();
+			if (!right_rest.empty() && !Parent::_grammar->empty(right_rest))
+				continue;
+
+			backtrack(ss.state, item, [&](std::uint32_t dest_id) {
+				targets.push_back(dest_id);
+			});
+		}
+	}
+
+private:
+	template <typename OnTargetF>
+	void backtrack(const StateType* state, const ItemType& item, OnTargetF&& on_target) const
+	{
+		// Now we'll start backtracking through LR automaton using backtransitions.
+		// We'll basically just go in the different direction of arrows in the automata.
+		// We know of what symbols 'a' in A -> a <*> B b is made of so we exactly know which
+		// backtransitions to take. There can be multiple transitions through the same symbol
+		// going into current state so we'll put them into queue and process until queue is empty.
+		std::unordered_set<const StateType*> visited_states;
+		std::deque<BacktrackingInfoType> to_process;
+		// Let's insert the current state and item A -> a <*> B b into the queue as a starting point
+		to_process.push_back(BacktrackingInfoType{state, item});
+		while (!to_process.empty())
+		{
+			auto backtracking_info = std::move(to_process.front());
+			to_process.pop_front();
+
+			// If we've reached state with item A -> <*> a B b, we've reached our destination
+			if (backtracking_info.item.get_read_pos() == 0)
+			{
+				// Insert relation
+				auto dest_id = Parent::_automaton->get_nonterminal_transition_id(backtracking_info.state, backtracking_info.item.get_rule()->get_lhs());
+				assert(dest_id && "This shouldn't happen");
+				on_target(dest_id.value());
+				continue;
+			}
+
+			// Observe backtransitions over the symbol left to the <*> in an item
+			const auto& back_trans = backtracking_info.state->get_back_transitions();
+			auto itr = back_trans.find(backtracking_info.item.get_previous_symbol());
+			if (itr == back_trans.end())
+				assert(false && "This shouldn't happen");
+
+			// Perform step back of an item so that <*> in an item is moved one symbol to the left
+			backtracking_info.item.step_back();
+			for (const auto& dest_state : itr->second)
+			{
+				if (visited_states.find(dest_state) == visited_states.end())
+				{
+					// Put non-visited states from backtransitions into the queue
+					to_process.push_back(BacktrackingInfoType{dest_state, backtracking_info.item});
+					visited_states.emplace(dest_state);
+				}
+			}
+		}
+	}
 };
 
 } // namespace pog
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cassert>
+#include <unordered_set>
+
 #include <pog/relations/relation.h>
 #include <pog/types/state_and_rule.h>
 #include <pog/types/state_and_symbol.h>
@@ -23,14 +26,18 @@ namespace pog {
  * This is useful for so-called propagation of lookaheads. If we know that rule A -> x is being used
  * and it all originated in certain state where rule B -> a A b is being processed, we can use what
  * can possible follow A in B -> a A b to know whether to use production of A -> x.
+ *
+ * Tuples (q,R) are represented by ids of reductions and tuples (p,x) by ids of nonterminal transitions
+ * assigned by the automaton.
  */
 template <typename ValueT>
-class Lookback : public Relation<ValueT, StateAndRule<ValueT>, StateAndSymbol<ValueT>>
+class Lookback : public Relation<ValueT>
 {
 public:
-	using Parent = Relation<ValueT, StateAndRule<ValueT>, StateAndSymbol<ValueT>>;
+	using Parent = Relation<ValueT>;
 
 	using AutomatonType = Automaton<ValueT>;
+	using ItemType = Item<ValueT>;
 	using BacktrackingInfoType = BacktrackingInfo<ValueT>;
 	using GrammarType = Grammar<ValueT>;
 	using StateType = State<ValueT>;
@@ -45,66 +52,76 @@ public:
 
 	virtual void calculate() override
 	{
-		// Iterate over all states of LR automaton
-		for (const auto& state : Parent::_automaton->get_states())
+		std::vector<std::pair<std::uint32_t, std::uint32_t>> edges;
+		std::vector<std::uint32_t> targets;
+
+		// Iterate over all final items A -> x <*> recorded in the automaton together with their states
+		for (std::uint32_t src_id = 0; src_id < node_count(); ++src_id)
+		{
+			targets.clear();
+			collect(src_id, targets);
+			for (auto dest_id : targets)
+				edges.emplace_back(src_id, dest_id);
+		}
+
+		Parent::build(node_count(), std::move(edges));
+	}
+
+protected:
+	virtual std::size_t node_count() const override
+	{
+		return Parent::_automaton->get_reductions().size();
+	}
+
+	virtual void collect(std::uint32_t node, std::vector<std::uint32_t>& targets) const override
+	{
+		const auto& reductions = Parent::_automaton->get_reductions();
+		const auto* state = reductions[node].state;
+		auto item = ItemType{reductions[node].rule, reductions[node].rule->get_rhs().size()};
+
+		// Get left-hand side symbol of a rule
+		auto prod_symbol = item.get_rule()->get_lhs();
+
+		// Now we'll start backtracking through LR automaton using backtransitions.
+		// We'll basically just go in the different direction of arrows in the automata.
+		// We know that we have item A -> x <*> so we know which backtransitions to take (those contained in sequence x).
+		// There can be multiple transitions through the same symbol
+		// going into current state so we'll put them into queue and process until queue is empty.
+		std::unordered_set<const StateType*> visited_states;
+		std::deque<BacktrackingInfoType> to_process;
+		// Let's insert the current state and item A -> x <*> into the queue as a starting point
+		to_process.push_back(BacktrackingInfoType{state, item});
+		while (!to_process.empty())
 		{
-			for (const auto& item : *state.get())
+			auto backtracking_info = std::move(to_process.front());
+			to_process.pop_front();
+
+			// If the state has transition over the symbol A, that means there is an item B -> a <*> A b
+			if (auto dest_id = Parent::_automaton->get_nonterminal_transition_id(backtracking_info.state, prod_symbol); dest_id)
+			{
+				// Insert relation
+				targets.push_back(dest_id.value());
+			}
+
+			// We've reached item with <*> at the start so we are no longer interested in it
+			if (backtracking_info.item.get_read_pos() == 0)
+				continue;
+
+			// Observe backtransitions over the symbol left to the <*> in an item
+			const auto& back_trans = backtracking_info.state->get_back_transitions();
+			auto itr = back_trans.find(backtracking_info.item.get_previous_symbol());
+			if (itr == back_trans.end())
+				assert(false && "This shouldn't happen");
+
+			// Perform step back of an item so that <*> in an item is moved one symbol to the left
+			backtracking_info.item.step_back();
+			for (const auto& dest_state : itr->second)
 			{
-				// We are not interested in items other than in form A -> x <*>
-				if (!item->is_final())
-					continue;
-
-				// Get left-hand side symbol of a rule
-				auto prod_symbol = item->get_rule()->get_lhs();
-
-				// Now we'll start backtracking through LR automaton using backtransitions.
-				// We'll basically just go in the different direction of arrows in the automata.
-				// We know that we have item A -> x <*> so we know which backtransitions to take (those contained in sequence x).
-				// There can be multiple transitions through the same symbol
-				// going into current state so we'll put them into queue and process until queue is empty.
-				std::unordered_set<const StateType*> visited_states;
-				std::deque<BacktrackingInfoType> to_process;
-				// Let's insert the current state and item A -> x <*> into the queue as a starting point
-				to_process.push_back(BacktrackingInfoType{state.get(), *item.get()});
-				while (!to_process.empty())
+				if (visited_states.find(dest_state) == visited_states.end())
 				{
-					auto backtracking_info = std::move(to_process.front());
-					to_process.pop_front();
-
-					// If the state has transition over the symbol A, that means there is an item B -> a <*> A b
-					if (backtracking_info.state->get_transitions().find(prod_symbol) != backtracking_info.state->get_transitions().end())
-					{
-						// Insert relation
-						StateAndRuleType src_sr{state.get(), item->get_rule()};
-						StateAndSymbolType dest_ss{backtracking_info.state, prod_symbol};
-						auto itr = Parent::_relation.find(src_sr);
-						if (itr == Parent::_relation.end())
-							Parent::_relation.emplace(std::move(src_sr), std::unordered_set<StateAndSymbolType>{std::move(dest_ss)});
-						else
-							itr->second.insert(std::move(dest_ss));
-					}
-
-					// We've reached item with <*> at the start so we are no longer interested in it
-					if (backtracking_info.item.get_read_pos() == 0)
-						continue;
-
-					// Observe backtransitions over the symbol left to the <*> in an item
-					const auto& back_trans = backtracking_info.state->get_back_transitions();
-					auto itr = back_trans.find(backtracking_info.item.get_previous_symbol());
-					if (itr == back_trans.end())
-						assert(false && "This shouldn't happen");
-
-					// Perform step back of an item so that <*> in an item is moved one symbol to the left
-					backtracking_info.item.step_back();
-					for (const auto& dest_state : itr->second)
-					{
-						if (visited_states.find(dest_state) == visited_states.end())
-						{
-							// Put non-visited states from backtransitions into the queue
-							to_process.push_back(BacktrackingInfoType{dest_state, backtracking_info.item});
-							visited_states.emplace(dest_state);
-						}
-					}
+					// Put non-visited states from backtransitions into the queue
+					to_process.push_back(BacktrackingInfoType{dest_state, backtracking_info.item});
+					visited_states.emplace(dest_state);
 				}
 			}
 		}
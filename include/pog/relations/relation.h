@@ -1,10 +1,14 @@
 #pragma once
 
-#include <unordered_map>
-#include <unordered_set>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
 
 #include <pog/automaton.h>
+#include <pog/bitset.h>
 #include <pog/grammar.h>
+#include <pog/utils.h>
 
 namespace pog {
 
@@ -15,50 +19,111 @@ struct BacktrackingInfo
 	Item<ValueT> item;
 };
 
-template <typename ValueT, typename LeftT, typename RightT = LeftT>
+/**
+ * Relation over densely numbered nodes. Left-hand side of the relation is given by the id
+ * of the node (nonterminal transition or reduction, see Automaton) and the right-hand side
+ * are always ids of nonterminal transitions.
+ *
+ * Relation is stored in CSR (compressed sparse row) format so all nodes related with node x
+ * can be found in range [offsets[x], offsets[x + 1]) of targets.
+ *
+ * Relation can also be calculated lazily. In that case, nodes related with node x are collected
+ * only once they are requested for the first time. Lazy calculation isn't thread-safe on its own,
+ * the caller needs to take care of synchronization.
+ */
+template <typename ValueT>
 class Relation
 {
 public:
 	using AutomatonType = Automaton<ValueT>;
 	using GrammarType = Grammar<ValueT>;
+	using RangeType = IteratorRange<std::vector<std::uint32_t>::const_iterator>;
 
-	Relation(const AutomatonType* automaton, const GrammarType* grammar) : _automaton(automaton), _grammar(grammar) {}
+	Relation(const AutomatonType* automaton, const GrammarType* grammar) : _automaton(automaton), _grammar(grammar), _offsets(), _targets(),
+		_lazy(false), _lazy_targets(), _lazy_collected() {}
 	Relation(const Relation&) = delete;
 	Relation(Relation&&) noexcept = default;
 	virtual ~Relation() = default;
 
 	virtual void calculate() = 0;
 
-	auto begin() { return _relation.begin(); }
-	auto end() { return _relation.end(); }
-
-	auto begin() const { return _relation.begin(); }
-	auto end() const { return _relation.end(); }
+	void calculate_lazily()
+	{
+		_lazy = true;
+		_offsets.clear();
+		_targets.clear();
+		_lazy_targets.assign(node_count(), {});
+		_lazy_collected = Bitset{_lazy_targets.size()};
+	}
 
-	template <typename T>
-	std::unordered_set<RightT>* find(const T& key)
+	std::size_t size() const
 	{
-		auto itr = _relation.find(key);
-		if (itr == _relation.end())
-			return nullptr;
+		if (_lazy)
+			return _lazy_targets.size();
 
-		return &itr->second;
+		return _offsets.empty() ? 0 : _offsets.size() - 1;
 	}
 
-	template <typename T>
-	const std::unordered_set<RightT>* find(const T& key) const
+	RangeType operator[](std::uint32_t node) const
 	{
-		auto itr = _relation.find(key);
-		if (itr == _relation.end())
-			return nullptr;
+		if (_lazy)
+		{
+			auto& targets = _lazy_targets[node];
+			if (!_lazy_collected.test(node))
+			{
+				collect(node, targets);
+				std::sort(targets.begin(), targets.end());
+				targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+				_lazy_collected.set(node);
+			}
 
-		return &itr->second;
+			return RangeType{targets.begin(), targets.end()};
+		}
+
+		return RangeType{_targets.begin() + _offsets[node], _targets.begin() + _offsets[node + 1]};
 	}
 
 protected:
+	/**
+	 * Number of nodes on the left-hand side of the relation.
+	 */
+	virtual std::size_t node_count() const = 0;
+
+	/**
+	 * Collects all nodes which are related with the given node. Used for lazy calculation.
+	 */
+	virtual void collect(std::uint32_t node, std::vector<std::uint32_t>& targets) const = 0;
+
+	/**
+	 * Builds CSR representation out of the list of edges. Edges don't need to be sorted
+	 * and can contain duplicates.
+	 */
+	void build(std::size_t node_count, std::vector<std::pair<std::uint32_t, std::uint32_t>>&& edges)
+	{
+		std::sort(edges.begin(), edges.end());
+		edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+		_offsets.assign(node_count + 1, 0);
+		_targets.clear();
+		_targets.reserve(edges.size());
+		for (const auto& [from, to] : edges)
+		{
+			_offsets[from + 1]++;
+			_targets.push_back(to);
+		}
+
+		for (std::size_t i = 1; i < _offsets.size(); ++i)
+			_offsets[i] += _offsets[i - 1];
+	}
+
 	const AutomatonType* _automaton;
 	const GrammarType* _grammar;
-	std::unordered_map<LeftT, std::unordered_set<RightT>> _relation;
+	std::vector<std::uint32_t> _offsets;
+	std::vector<std::uint32_t> _targets;
+
+	bool _lazy;
+	mutable std::vector<std::vector<std::uint32_t>> _lazy_targets;
+	mutable Bitset _lazy_collected;
 };
 
 } // namespace pog
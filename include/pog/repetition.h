@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace pog {
+
+enum class RepetitionKind
+{
+	ZeroOrMore,
+	OneOrMore,
+	Optional
+};
+
+/**
+ * Symbol with repetition operator which can be used in productions of RuleBuilder. It is turned into
+ * helper nonterminal with its own rules. Values of the repeated symbol are accumulated into a single value
+ * using append(list, value) which modifies the list directly on the stack of the parser. The list starts
+ * as the result of init() or default value of ValueT if there is no init.
+ *
+ * Use functions star(), plus() and opt() to create them.
+ */
+template <typename InitT, typename AppendT>
+struct Repetition
+{
+	RepetitionKind kind;
+	std::string symbol;
+	InitT init;
+	AppendT append;
+};
+
+/**
+ * Zero or more occurrences of the symbol.
+ */
+template <typename AppendT>
+auto star(const std::string& symbol, AppendT&& append)
+{
+	return Repetition<std::nullptr_t, std::decay_t<AppendT>>{RepetitionKind::ZeroOrMore, symbol, nullptr, std::forward<AppendT>(append)};
+}
+
+template <typename InitT, typename AppendT>
+auto star(const std::string& symbol, InitT&& init, AppendT&& append)
+{
+	return Repetition<std::decay_t<InitT>, std::decay_t<AppendT>>{RepetitionKind::ZeroOrMore, symbol, std::forward<InitT>(init), std::forward<AppendT>(append)};
+}
+
+/**
+ * One or more occurrences of the symbol.
+ */
+template <typename AppendT>
+auto plus(const std::string& symbol, AppendT&& append)
+{
+	return Repetition<std::nullptr_t, std::decay_t<AppendT>>{RepetitionKind::OneOrMore, symbol, nullptr, std::forward<AppendT>(append)};
+}
+
+template <typename InitT, typename AppendT>
+auto plus(const std::string& symbol, InitT&& init, AppendT&& append)
+{
+	return Repetition<std::decay_t<InitT>, std::decay_t<AppendT>>{RepetitionKind::OneOrMore, symbol, std::forward<InitT>(init), std::forward<AppendT>(append)};
+}
+
+/**
+ * Optional symbol. Its value is the value of the symbol or default value of ValueT if it's missing.
+ */
+inline auto opt(const std::string& symbol)
+{
+	return Repetition<std::nullptr_t, std::nullptr_t>{RepetitionKind::Optional, symbol, nullptr, nullptr};
+}
+
+} // namespace pog
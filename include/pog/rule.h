@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cassert>
 #include <functional>
 #include <optional>
 #include <string>
@@ -19,13 +20,15 @@ class Rule
 public:
 	using SymbolType = Symbol<ValueT>;
 	using CallbackType = std::function<ValueT(std::vector<ValueT>&&)>;
+	using AccumulatorType = std::function<void(ValueT&, ValueT&&)>;
+	using SinkType = std::function<void(ValueT&&)>;
 
 	Rule(std::uint32_t index, const SymbolType* lhs, const std::vector<const SymbolType*>& rhs)
-		: _index(index), _lhs(lhs), _rhs(rhs), _action(), _midrule_size(std::nullopt), _start(false) {}
+		: _index(index), _lhs(lhs), _rhs(rhs), _action(), _accumulator(), _sink(), _midrule_size(std::nullopt), _used_arguments(), _start(false), _pruned(false), _inlined(false) {}
 
 	template <typename CallbackT>
 	Rule(std::uint32_t index, const SymbolType* lhs, const std::vector<const SymbolType*>& rhs, CallbackT&& action)
-		: _index(index), _lhs(lhs), _rhs(rhs), _action(std::forward<CallbackT>(action)), _midrule_size(std::nullopt), _start(false) {}
+		: _index(index), _lhs(lhs), _rhs(rhs), _action(std::forward<CallbackT>(action)), _accumulator(), _sink(), _midrule_size(std::nullopt), _used_arguments(), _start(false), _pruned(false), _inlined(false) {}
 
 	std::uint32_t get_index() const { return _index; }
 	const SymbolType* get_lhs() const { return _lhs; }
@@ -63,9 +66,14 @@ public:
 	}
 
 	bool has_action() const { return static_cast<bool>(_action); }
+	const CallbackType& get_action() const { return _action; }
 	bool is_start_rule() const { return _start; }
+	bool is_pruned() const { return _pruned; }
+	bool is_inlined() const { return _inlined; }
 
 	void set_start_rule(bool set) { _start = set; }
+	void set_pruned(bool set) { _pruned = set; }
+	void set_inlined(bool set) { _inlined = set; }
 	void set_midrule(std::size_t size) { _midrule_size = size; }
 	bool is_midrule() const { return static_cast<bool>(_midrule_size); }
 	std::size_t get_midrule_size() const { return _midrule_size.value(); }
@@ -73,6 +81,40 @@ public:
 	template <typename... Args>
 	ValueT perform_action(Args&&... args) const { return _action(std::forward<Args>(args)...); }
 
+	/**
+	 * Rule can declare which arguments its action uses. Values of lazy tokens are computed only for the used
+	 * arguments, the rest of them is passed to the action as default value of ValueT. Without declaration,
+	 * all arguments are considered used.
+	 */
+	bool is_argument_used(std::size_t index) const { return !_used_arguments || (*_used_arguments)[index]; }
+	void set_used_arguments(const std::vector<std::size_t>& indices)
+	{
+		std::vector<bool> used(get_number_of_required_arguments_for_action(), false);
+		for (auto index : indices)
+		{
+			assert(index < used.size() && "Used argument out of range of the rule");
+			used[index] = true;
+		}
+		_used_arguments = std::move(used);
+	}
+
+	/**
+	 * Accumulating rule L -> L X doesn't have regular action. Value of X is instead appended to the value of L
+	 * which is modified in place.
+	 */
+	bool is_accumulating() const { return static_cast<bool>(_accumulator); }
+	void set_accumulator(AccumulatorType accumulator) { _accumulator = std::move(accumulator); }
+	void accumulate(ValueT& accumulator, ValueT&& value) const { _accumulator(accumulator, std::move(value)); }
+
+	/**
+	 * Rule with sink passes the result of its action to the sink instead of leaving it on the stack of the parser
+	 * and only default value of ValueT remains on the stack in its place.
+	 */
+	bool has_sink() const { return static_cast<bool>(_sink); }
+	const SinkType& get_sink() const { return _sink; }
+	void set_sink(SinkType sink) { _sink = std::move(sink); }
+	void sink(ValueT&& value) const { _sink(std::move(value)); }
+
 	bool operator==(const Rule& rhs) const { return _index == rhs._index; }
 	bool operator!=(const Rule& rhs) const { return !(*this == rhs); }
 
@@ -81,9 +123,14 @@ private:
 	const SymbolType* _lhs;
 	std::vector<const SymbolType*> _rhs;
 	CallbackType _action;
+	AccumulatorType _accumulator;
+	SinkType _sink;
 	std::optional<Precedence> _precedence;
 	std::optional<std::size_t> _midrule_size;
+	std::optional<std::vector<bool>> _used_arguments;
 	bool _start;
+	bool _pruned;
+	bool _inlined;
 };
 
 } // namespace pog
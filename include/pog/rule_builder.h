@@ -1,6 +1,10 @@
 #pragma once
 
+#include <cassert>
+#include <functional>
+
 #include <pog/grammar.h>
+#include <pog/repetition.h>
 #include <pog/rule.h>
 
 namespace pog {
@@ -23,16 +27,33 @@ public:
 	{
 		std::vector<SymbolsAndAction> symbols_and_action;
 		std::optional<Precedence> precedence;
+		std::optional<std::vector<std::size_t>> used_arguments;
+		typename RuleType::SinkType sink;
 	};
 
-	RuleBuilder(GrammarType* grammar, const std::string& lhs) : _grammar(grammar), _lhs(lhs), _rhss() {}
+	struct RepeatedSymbol
+	{
+		std::string name;
+		std::string symbol;
+		RepetitionKind kind;
+		std::function<ValueT()> init;
+		typename RuleType::AccumulatorType append;
+	};
+
+	RuleBuilder(GrammarType* grammar, const std::string& lhs) : _grammar(grammar), _lhs(lhs), _rhss(), _inlined(false),
+		_repetitions(), _next_repetition_index(0) {}
 
 	void done()
 	{
 		if (_rhss.empty())
 			return;
 
-		const auto* lhs_symbol = _grammar->add_symbol(SymbolKind::Nonterminal, _lhs);
+		auto* lhs_symbol = _grammar->add_symbol(SymbolKind::Nonterminal, _lhs);
+		if (_inlined)
+			lhs_symbol->set_inlined(true);
+
+		for (auto&& repetition : _repetitions)
+			add_repetition_rules(std::move(repetition));
 
 		std::size_t rhs_counter = 0;
 		for (auto&& rhs : _rhss)
@@ -79,6 +100,10 @@ public:
 						const auto& prec = rhs.precedence.value();
 						rule->set_precedence(prec.level, prec.assoc);
 					}
+					if (rule && rhs.used_arguments)
+						rule->set_used_arguments(rhs.used_arguments.value());
+					if (rule && rhs.sink)
+						rule->set_sink(std::move(rhs.sink));
 				}
 			}
 
@@ -96,7 +121,9 @@ public:
 					{}
 				}
 			},
-			std::nullopt
+			std::nullopt,
+			std::nullopt,
+			{}
 		});
 		_production(_rhss.back().symbols_and_action, std::forward<Args>(args)...);
 		return *this;
@@ -108,7 +135,92 @@ public:
 		return *this;
 	}
 
+	/**
+	 * Declares which arguments the final action of the last production uses. Values of lazy tokens
+	 * in other arguments are never computed and the action receives default values for them.
+	 */
+	RuleBuilder& used_arguments(std::vector<std::size_t> indices)
+	{
+		_rhss.back().used_arguments = std::move(indices);
+		return *this;
+	}
+
+	/**
+	 * Results of the action of the last production are passed to the sink as soon as it is reduced instead of staying
+	 * on the stack of the parser. Use it for rules like document -> document entry to process entries one by one
+	 * so the memory doesn't grow with the length of the input.
+	 *
+	 * Sinks are always called on the calling thread in input order, including when ReductionLog::evaluate() uses more threads.
+	 * They can however be called again for the same input after restoring the checkpoint.
+	 */
+	template <typename CallbackT>
+	RuleBuilder& sink(CallbackT&& callback)
+	{
+		_rhss.back().sink = std::forward<CallbackT>(callback);
+		return *this;
+	}
+
+	/**
+	 * Marks the left-hand side symbol as inlined. Its productions are then expanded into every rule
+	 * where the symbol occurs instead of being reduced on their own (see Grammar::inline_symbols()).
+	 */
+	RuleBuilder& inlined()
+	{
+		_inlined = true;
+		return *this;
+	}
+
 private:
+	/**
+	 * Creates rules of helper nonterminal L for repeated symbol X. Rule L -> L X is accumulating so the list
+	 * is modified in place instead of being moved through the action.
+	 */
+	void add_repetition_rules(RepeatedSymbol&& repetition)
+	{
+		const auto* list_symbol = _grammar->add_symbol(SymbolKind::Nonterminal, repetition.name);
+		const auto* symbol = _grammar->add_symbol(SymbolKind::Nonterminal, repetition.symbol);
+
+		auto init = std::move(repetition.init);
+		switch (repetition.kind)
+		{
+			case RepetitionKind::ZeroOrMore:
+			{
+				// L -> <eps>
+				typename RuleType::CallbackType init_action;
+				if (init)
+					init_action = [init](auto&&) -> ValueT { return init(); };
+				_grammar->add_rule(list_symbol, std::vector<const SymbolType*>{}, std::move(init_action));
+				// L -> L X
+				auto rule = _grammar->add_rule(list_symbol, std::vector<const SymbolType*>{list_symbol, symbol}, typename RuleType::CallbackType{});
+				rule->set_accumulator(std::move(repetition.append));
+				break;
+			}
+			case RepetitionKind::OneOrMore:
+			{
+				// L -> X
+				_grammar->add_rule(list_symbol, std::vector<const SymbolType*>{symbol}, [init, append = repetition.append](auto&& args) -> ValueT {
+					ValueT list = init ? init() : ValueT{};
+					append(list, std::move(args[0]));
+					return list;
+				});
+				// L -> L X
+				auto rule = _grammar->add_rule(list_symbol, std::vector<const SymbolType*>{list_symbol, symbol}, typename RuleType::CallbackType{});
+				rule->set_accumulator(std::move(repetition.append));
+				break;
+			}
+			case RepetitionKind::Optional:
+			{
+				// L -> <eps>
+				_grammar->add_rule(list_symbol, std::vector<const SymbolType*>{}, typename RuleType::CallbackType{});
+				// L -> X
+				_grammar->add_rule(list_symbol, std::vector<const SymbolType*>{symbol}, [](auto&& args) -> ValueT {
+					return std::move(args[0]);
+				});
+				break;
+			}
+		}
+	}
+
 	void _production(std::vector<SymbolsAndAction>&) {}
 
 	template <typename... Args>
@@ -118,6 +230,31 @@ private:
 		_production(sa, std::forward<Args>(args)...);
 	}
 
+	template <typename InitT, typename AppendT, typename... Args>
+	void _production(std::vector<SymbolsAndAction>& sa, Repetition<InitT, AppendT> repetition, Args&&... args)
+	{
+		static constexpr const char* suffixes[] = {"*", "+", "?"};
+
+		// Helper nonterminal gets unique name even if there are more rule builders for the same symbol. Its rules are added
+		// only once the builder is done, so the symbol is added right away to reserve the name for this builder.
+		std::string name;
+		do
+		{
+			name = fmt::format("_{}{}#{}.{}", repetition.symbol, suffixes[static_cast<int>(repetition.kind)], _lhs, _next_repetition_index++);
+		} while (_grammar->get_symbol(name));
+		_grammar->add_symbol(SymbolKind::Nonterminal, name);
+
+		RepeatedSymbol repeated_symbol{name, repetition.symbol, repetition.kind, {}, {}};
+		if constexpr (!std::is_same_v<InitT, std::nullptr_t>)
+			repeated_symbol.init = std::move(repetition.init);
+		if constexpr (!std::is_same_v<AppendT, std::nullptr_t>)
+			repeated_symbol.append = std::move(repetition.append);
+
+		_repetitions.push_back(std::move(repeated_symbol));
+		sa.back().symbols.push_back(name);
+		_production(sa, std::forward<Args>(args)...);
+	}
+
 	template <typename... Args>
 	void _production(std::vector<SymbolsAndAction>& sa, typename RuleType::CallbackType&& action, Args&&... args)
 	{
@@ -135,6 +272,9 @@ private:
 	GrammarType* _grammar;
 	std::string _lhs;
 	std::vector<RightHandSide> _rhss;
+	bool _inlined;
+	std::vector<RepeatedSymbol> _repetitions;
+	std::size_t _next_repetition_index;
 };
 
 } // namespace pog
@@ -1,9 +1,10 @@
 #pragma once
 
+#include <algorithm>
 #include <numeric>
+#include <optional>
 #include <unordered_set>
 
-#include <pog/filter_view.h>
 #include <pog/item.h>
 #include <pog/utils.h>
 
@@ -16,8 +17,8 @@ public:
 	using ItemType = Item<ValueT>;
 	using SymbolType = Symbol<ValueT>;
 
-	State() : _index(std::numeric_limits<decltype(_index)>::max()) {}
-	State(std::uint32_t index) : _index(index) {}
+	State() : State(std::numeric_limits<std::uint32_t>::max()) {}
+	State(std::uint32_t index) : _index(index), _items(), _kernel_size(0), _kernel_hash(), _transitions(), _back_transitions() {}
 
 	std::uint32_t get_index() const { return _index; }
 	void set_index(std::uint32_t index) { _index = index; }
@@ -26,20 +27,48 @@ public:
 	auto begin() const { return _items.begin(); }
 	auto end() const { return _items.end(); }
 
+	/**
+	 * Adds single item to the state while keeping items sorted. Returns whether the item
+	 * was really added or the state already contained it.
+	 */
 	template <typename T>
-	std::pair<ItemType*, bool> add_item(T&& item)
+	bool add_item(T&& item)
 	{
-		auto itr = std::lower_bound(_items.begin(), _items.end(), item, [](const auto& left, const auto& needle) {
-			return *left.get() < needle;
-		});
+		auto itr = std::lower_bound(_items.begin(), _items.end(), item);
+		if (itr != _items.end() && *itr == item)
+			return false;
 
-		if (itr == _items.end() || *itr->get() != item)
+		if (item.is_kernel())
 		{
-			auto new_itr = _items.insert(itr, std::make_unique<ItemType>(std::forward<T>(item)));
-			return {new_itr->get(), true};
+			_kernel_size++;
+			_kernel_hash.reset();
+		}
+
+		_items.insert(itr, std::forward<T>(item));
+		return true;
+	}
+
+	/**
+	 * Adds multiple items at once. Items are appended and the whole state is sorted
+	 * just once afterwards which is much cheaper than inserting them one by one.
+	 */
+	void add_items(std::vector<ItemType>&& items)
+	{
+		_items.reserve(_items.size() + items.size());
+		std::move(items.begin(), items.end(), std::back_inserter(_items));
+		std::sort(_items.begin(), _items.end());
+		_items.erase(std::unique(_items.begin(), _items.end()), _items.end());
+
+		// Kernel items are always sorted before non-kernel items
+		auto kernel_end = std::partition_point(_items.begin(), _items.end(), [](const auto& item) {
+			return item.is_kernel();
+		});
+		auto kernel_size = static_cast<std::size_t>(std::distance(_items.begin(), kernel_end));
+		if (kernel_size != _kernel_size)
+		{
+			_kernel_size = kernel_size;
+			_kernel_hash.reset();
 		}
-		else
-			return {itr->get(), false};
 	}
 
 	void add_transition(const SymbolType* symbol, const State* state)
@@ -67,7 +96,7 @@ public:
 	bool is_accepting() const
 	{
 		return std::count_if(_items.begin(), _items.end(), [](const auto& item) {
-				return item->is_accepting();
+				return item.is_accepting();
 			}) == 1;
 	}
 
@@ -75,7 +104,7 @@ public:
 	{
 		std::vector<std::string> item_strings(_items.size());
 		std::transform(_items.begin(), _items.end(), item_strings.begin(), [&](const auto& item) {
-			return item->to_string(arrow, eps, sep);
+			return item.to_string(arrow, eps, sep);
 		});
 		return fmt::format("{}", fmt::join(item_strings.begin(), item_strings.end(), newline));
 	}
@@ -85,37 +114,49 @@ public:
 		std::vector<const ItemType*> result;
 		transform_if(_items.begin(), _items.end(), std::back_inserter(result),
 			[](const auto& item) {
-				return item->is_final();
+				return item.is_final();
 			},
 			[](const auto& item) {
-				return item.get();
+				return &item;
 			}
 		);
 		return result;
 	}
 
+	/**
+	 * Kernel items are always stored as a contiguous prefix of all items.
+	 */
 	auto get_kernel() const
 	{
-		return FilterView{_items.begin(), _items.end(), [](const auto& item) {
-			return item->is_kernel();
-		}};
+		return IteratorRange{_items.begin(), _items.begin() + _kernel_size};
+	}
+
+	std::size_t get_kernel_hash() const
+	{
+		if (!_kernel_hash)
+		{
+			std::size_t kernel_hash = 0;
+			for (const auto& item : get_kernel())
+				hash_combine(kernel_hash, item.get_rule()->get_index(), item.get_read_pos());
+			_kernel_hash = kernel_hash;
+		}
+
+		return _kernel_hash.value();
 	}
 
 	bool contains(const ItemType& item) const
 	{
-		auto itr = std::lower_bound(_items.begin(), _items.end(), item, [](const auto& left, const auto& needle) {
-			return *left.get() < needle;
-		});
-		return itr != _items.end() && *itr->get() == item;
+		return std::binary_search(_items.begin(), _items.end(), item);
 	}
 
 	bool operator==(const State& rhs) const
 	{
+		if (_kernel_size != rhs._kernel_size || get_kernel_hash() != rhs.get_kernel_hash())
+			return false;
+
 		auto lhs_kernel = get_kernel();
 		auto rhs_kernel = rhs.get_kernel();
-		return std::equal(lhs_kernel.begin(), lhs_kernel.end(), rhs_kernel.begin(), rhs_kernel.end(), [](const auto& left, const auto& right) {
-			return *left.get() == *right.get();
-		});
+		return std::equal(lhs_kernel.begin(), lhs_kernel.end(), rhs_kernel.begin(), rhs_kernel.end());
 	}
 
 	bool operator !=(const State& rhs) const
@@ -128,7 +169,9 @@ public:
 
 private:
 	std::uint32_t _index;
-	std::vector<std::unique_ptr<ItemType>> _items;
+	std::vector<ItemType> _items;
+	std::size_t _kernel_size;
+	mutable std::optional<std::size_t> _kernel_hash;
 	std::map<const SymbolType*, const State*, SymbolLess<ValueT>> _transitions;
 	std::map<const SymbolType*, std::vector<const State*>, SymbolLess<ValueT>> _back_transitions;
 };
@@ -138,10 +181,7 @@ struct StateKernelHash
 {
 	std::size_t operator()(const State<ValueT>* state) const
 	{
-		std::size_t kernel_hash = 0;
-		for (const auto& item : state->get_kernel())
-			hash_combine(kernel_hash, item->get_rule()->get_index(), item->get_read_pos());
-		return kernel_hash;
+		return state->get_kernel_hash();
 	}
 };
 
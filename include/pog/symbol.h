@@ -20,7 +20,7 @@ template <typename ValueT>
 class Symbol
 {
 public:
-	Symbol(std::uint32_t index, SymbolKind kind, const std::string& name) : _index(index), _kind(kind), _name(name) {}
+	Symbol(std::uint32_t index, SymbolKind kind, const std::string& name) : _index(index), _kind(kind), _name(name), _inlined(false), _start_marker(false) {}
 
 	std::uint32_t get_index() const { return _index; }
 	const Precedence& get_precedence() const { return _precedence.value(); }
@@ -31,9 +31,13 @@ public:
 	bool is_end() const { return _kind == SymbolKind::End; }
 	bool is_nonterminal() const { return _kind == SymbolKind::Nonterminal; }
 	bool is_terminal() const { return _kind == SymbolKind::Terminal; }
+	bool is_inlined() const { return _inlined; }
+	bool is_start_marker() const { return _start_marker; }
 
 	void set_precedence(std::uint32_t level, Associativity assoc) { _precedence = Precedence{level, assoc}; }
 	void set_description(const std::string& description) { _description = description; }
+	void set_inlined(bool set) { _inlined = set; }
+	void set_start_marker(bool set) { _start_marker = set; }
 
 private:
 	std::uint32_t _index;
@@ -41,6 +45,8 @@ private:
 	std::string _name;
 	std::optional<std::string> _description;
 	std::optional<Precedence> _precedence;
+	bool _inlined;
+	bool _start_marker; ///< Internal terminal which selects start symbol, it's never read from the input
 };
 
 
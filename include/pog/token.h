@@ -4,9 +4,13 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 
 #include <re2/re2.h>
 
+#include <pog/interning_pool.h>
+#include <pog/matchers.h>
+#include <pog/prefix_pattern.h>
 #include <pog/symbol.h>
 
 namespace pog {
@@ -17,36 +21,97 @@ class Token
 public:
 	using SymbolType = Symbol<ValueT>;
 	using CallbackType = std::function<ValueT(std::string_view)>;
+	using MatcherType = std::function<std::size_t(std::string_view)>;
 
 	template <typename StatesT>
 	Token(std::uint32_t index, const std::string& pattern, StatesT&& active_in_states) : Token(index, pattern, std::forward<StatesT>(active_in_states), nullptr) {}
 
 	template <typename StatesT>
 	Token(std::uint32_t index, const std::string& pattern, StatesT&& active_in_states, const SymbolType* symbol)
-		: _index(index), _pattern(pattern), _symbol(symbol), _regexp(std::make_unique<re2::RE2>(_pattern)), _action(),
-			_enter_state(), _active_in_states(std::forward<StatesT>(active_in_states)) {}
+		: _index(index), _pattern(pattern), _symbol(symbol), _regexp(std::make_unique<re2::RE2>(_pattern)), _prefix_regexp(), _action(),
+			_matcher(), _first_bytes(), _enter_state(), _active_in_states(std::forward<StatesT>(active_in_states)), _lazy(false), _interning_pool(nullptr) {}
+
+	/**
+	 * Creates token which is matched by the matcher instead of regular expression. Matcher is tried only if the input starts
+	 * with one of the first bytes.
+	 */
+	template <typename StatesT>
+	Token(std::uint32_t index, MatcherType matcher, const ByteSet& first_bytes, StatesT&& active_in_states, const SymbolType* symbol)
+		: _index(index), _pattern(), _symbol(symbol), _regexp(), _prefix_regexp(), _action(), _matcher(std::move(matcher)), _first_bytes(first_bytes),
+			_enter_state(), _active_in_states(std::forward<StatesT>(active_in_states)), _lazy(false), _interning_pool(nullptr) {}
 
 	std::uint32_t get_index() const { return _index; }
 	const std::string& get_pattern() const { return _pattern; }
 	const SymbolType* get_symbol() const { return _symbol; }
 	const re2::RE2* get_regexp() const { return _regexp.get(); }
+	const ByteSet& get_first_bytes() const { return _first_bytes; }
+
+	/**
+	 * Regular expression matching all prefixes of the strings which the token matches, see prepare_prefix_regexp().
+	 * It is nullptr for tokens with matchers or if it couldn't be built.
+	 */
+	const re2::RE2* get_prefix_regexp() const { return _prefix_regexp.get(); }
+
+	/**
+	 * Builds regular expression whose longest match tells how far the regular expression of the token reads the input.
+	 * It does nothing if it was already built.
+	 */
+	void prepare_prefix_regexp()
+	{
+		if (_prefix_regexp || has_matcher())
+			return;
+
+		auto pattern = prefix_pattern(_pattern);
+		if (!pattern)
+			return;
+
+		re2::RE2::Options options;
+		options.set_longest_match(true);
+		options.set_log_errors(false);
+		auto regexp = std::make_unique<re2::RE2>(pattern.value(), options);
+		if (regexp->ok())
+			_prefix_regexp = std::move(regexp);
+	}
+
+	bool has_matcher() const { return static_cast<bool>(_matcher); }
+
+	/**
+	 * Returns the length of the match of the matcher at the start of the input or 0 if it doesn't match.
+	 */
+	std::size_t match(std::string_view input) const
+	{
+		return _matcher(input);
+	}
 
 	bool has_symbol() const { return _symbol != nullptr; }
 	bool has_action() const { return static_cast<bool>(_action); }
 	bool has_transition_to_state() const { return static_cast<bool>(_enter_state); }
 
+	/**
+	 * Action of lazy token isn't performed when the token is matched. Parser keeps only the matched text
+	 * and performs the action once some rule action actually needs the value of the token.
+	 */
+	bool is_lazy() const { return _lazy; }
+	void set_lazy(bool set) { _lazy = set; }
+
 	template <typename CallbackT>
 	void set_action(CallbackT&& action)
 	{
 		_action = std::forward<CallbackT>(action);
 	}
 
-	template <typename... Args>
-	ValueT perform_action(Args&&... args) const
+	ValueT perform_action(std::string_view str) const
 	{
-		return _action(std::forward<Args>(args)...);
+		return _action(_interning_pool ? _interning_pool->intern(str) : str);
 	}
 
+	/**
+	 * Action of interned token receives the matched text interned in the given pool instead of the view
+	 * into the input, so the text stays valid as long as the pool does.
+	 */
+	bool is_interned() const { return _interning_pool != nullptr; }
+	void set_interning_pool(InterningPool* pool) { _interning_pool = pool; }
+
 	void set_transition_to_state(const std::string& state)
 	{
 		_enter_state = state;
@@ -73,9 +138,14 @@ private:
 	std::string _pattern;
 	const SymbolType* _symbol;
 	std::unique_ptr<re2::RE2> _regexp;
+	std::unique_ptr<re2::RE2> _prefix_regexp;
 	CallbackType _action;
+	MatcherType _matcher;
+	ByteSet _first_bytes;
 	std::optional<std::string> _enter_state;
 	std::vector<std::string> _active_in_states;
+	bool _lazy;
+	InterningPool* _interning_pool;
 };
 
 } // namespace pog
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <type_traits>
+
 #include <pog/grammar.h>
+#include <pog/matchers.h>
 #include <pog/token.h>
 #include <pog/tokenizer.h>
 
@@ -15,11 +18,23 @@ public:
 	using TokenType = Token<ValueT>;
 	using TokenizerType = Tokenizer<ValueT>;
 
-	TokenBuilder(GrammarType* grammar, TokenizerType* tokenizer) : _grammar(grammar), _tokenizer(tokenizer), _pattern("$"),
-		_symbol_name(), _precedence(), _action(), _fullword(false), _end_token(true), _in_states{std::string{TokenizerType::DefaultState}}, _enter_state() {}
+	TokenBuilder(GrammarType* grammar, TokenizerType* tokenizer) : _grammar(grammar), _tokenizer(tokenizer), _pattern("$"), _matcher(), _first_bytes(),
+		_symbol_name(), _precedence(), _action(), _fullword(false), _end_token(true), _in_states{std::string{TokenizerType::DefaultState}}, _enter_state(), _lazy(false), _interned(false) {}
+
+	TokenBuilder(GrammarType* grammar, TokenizerType* tokenizer, const std::string& pattern) : _grammar(grammar), _tokenizer(tokenizer), _pattern(pattern), _matcher(), _first_bytes(),
+		_symbol_name(), _precedence(), _action(), _fullword(false), _end_token(false), _in_states{std::string{TokenizerType::DefaultState}}, _enter_state(), _lazy(false), _interned(false) {}
 
-	TokenBuilder(GrammarType* grammar, TokenizerType* tokenizer, const std::string& pattern) : _grammar(grammar), _tokenizer(tokenizer), _pattern(pattern),
-		_symbol_name(), _precedence(), _action(), _fullword(false), _end_token(false), _in_states{std::string{TokenizerType::DefaultState}}, _enter_state() {}
+	/**
+	 * Token is matched by the matcher instead of regular expression, see pog::matchers. It takes part in the selection of the longest
+	 * match together with all other tokens and equally long matches are decided by the order of tokens as usual.
+	 */
+	template <typename MatcherT, typename = std::enable_if_t<std::is_invocable_r_v<std::size_t, MatcherT&, std::string_view>>>
+	TokenBuilder(GrammarType* grammar, TokenizerType* tokenizer, MatcherT&& matcher) : _grammar(grammar), _tokenizer(tokenizer), _pattern(),
+		_matcher(), _first_bytes(get_first_bytes(matcher)), _symbol_name(), _precedence(), _action(), _fullword(false), _end_token(false),
+		_in_states{std::string{TokenizerType::DefaultState}}, _enter_state(), _lazy(false), _interned(false)
+	{
+		_matcher = std::forward<MatcherT>(matcher);
+	}
 
 	void done()
 	{
@@ -27,7 +42,10 @@ public:
 		if (!_end_token)
 		{
 			auto* symbol = !_symbol_name.empty() ? _grammar->add_symbol(SymbolKind::Terminal, _symbol_name) : nullptr;
-			token = _tokenizer->add_token(_fullword ? fmt::format("{}(\\b|$)", _pattern) : _pattern, symbol, std::move(_in_states));
+			if (_matcher)
+				token = _tokenizer->add_token(_fullword ? fullword_matcher(std::move(_matcher)) : std::move(_matcher), _first_bytes, symbol, std::move(_in_states));
+			else
+				token = _tokenizer->add_token(_fullword ? fmt::format("{}(\\b|$)", _pattern) : _pattern, symbol, std::move(_in_states));
 			if (symbol && _precedence)
 			{
 				const auto& prec = _precedence.value();
@@ -49,6 +67,10 @@ public:
 
 		if (_action)
 			token->set_action(std::move(_action));
+		if (_lazy)
+			token->set_lazy(true);
+		if (_interned)
+			token->set_interning_pool(_tokenizer->get_interning_pool());
 	}
 
 	TokenBuilder& symbol(const std::string& symbol_name)
@@ -76,6 +98,26 @@ public:
 		return *this;
 	}
 
+	/**
+	 * Defers the action of the token until the value of the token is used in some rule action. Action
+	 * of lazy token should therefore only convert the matched text and not depend on the state of the tokenizer.
+	 */
+	TokenBuilder& lazy()
+	{
+		_lazy = true;
+		return *this;
+	}
+
+	/**
+	 * Action of the token receives the matched text interned in the interning pool of the parser, so
+	 * all occurrences of the same text share the same view which stays valid as long as the parser.
+	 */
+	TokenBuilder& interned()
+	{
+		_interned = true;
+		return *this;
+	}
+
 	TokenBuilder& fullword()
 	{
 		_fullword = true;
@@ -96,10 +138,28 @@ public:
 	}
 
 private:
+	/**
+	 * Matcher only matches if its match ends on word boundary just like pattern (\b|$) does for regular expressions.
+	 */
+	static typename TokenType::MatcherType fullword_matcher(typename TokenType::MatcherType&& matcher)
+	{
+		return [matcher = std::move(matcher)](std::string_view input) -> std::size_t {
+			auto length = matcher(input);
+			if (length == 0 || length == input.size())
+				return length;
+
+			auto word_end = matchers::detail::is_identifier_char(input[length - 1]);
+			auto word_next = matchers::detail::is_identifier_char(input[length]);
+			return word_end != word_next ? length : 0;
+		};
+	}
+
 	GrammarType* _grammar;
 	TokenizerType* _tokenizer;
 	std::string _description;
 	std::string _pattern;
+	typename TokenType::MatcherType _matcher;
+	ByteSet _first_bytes;
 	std::string _symbol_name;
 	std::optional<Precedence> _precedence;
 	typename TokenType::CallbackType _action;
@@ -107,6 +167,8 @@ private:
 	bool _end_token;
 	std::vector<std::string> _in_states;
 	std::optional<std::string> _enter_state;
+	bool _lazy;
+	bool _interned;
 };
 
 } // namespace pog
@@ -1,6 +1,12 @@
 #pragma once
 
+#include <algorithm>
+#include <cassert>
+#include <iterator>
 #include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_set>
 #include <vector>
 
 #include <fmt/format.h>
@@ -17,6 +23,8 @@
 #endif
 
 #include <pog/grammar.h>
+#include <pog/interning_pool.h>
+#include <pog/memory_resource.h>
 #include <pog/token.h>
 
 namespace pog {
@@ -24,9 +32,10 @@ namespace pog {
 template <typename ValueT>
 struct TokenMatch
 {
-	TokenMatch(const Symbol<ValueT>* sym) : symbol(sym), value(), match_length(0) {}
+	TokenMatch(const Symbol<ValueT>* sym) : symbol(sym), value(), match_length(0), offset(0), lexeme(), lazy_token(nullptr) {}
 	template <typename T>
-	TokenMatch(const Symbol<ValueT>* sym, T&& v, std::size_t len) : symbol(sym), value(std::forward<T>(v)), match_length(len) {}
+	TokenMatch(const Symbol<ValueT>* sym, T&& v, std::size_t len, std::size_t off = 0, std::string_view lex = {}, const Token<ValueT>* lazy = nullptr)
+		: symbol(sym), value(std::forward<T>(v)), match_length(len), offset(off), lexeme(lex), lazy_token(lazy) {}
 	TokenMatch(const TokenMatch&) = default;
 	TokenMatch(TokenMatch&&) noexcept = default;
 
@@ -36,11 +45,14 @@ struct TokenMatch
 	const Symbol<ValueT>* symbol;
 	ValueT value;
 	std::size_t match_length;
+	std::size_t offset; ///< Offset of the token in the input stream it was read from
+	std::string_view lexeme; ///< Matched text, valid until the input streams are cleared (or released if they are retained)
+	const Token<ValueT>* lazy_token; ///< Lazy token whose action wasn't performed yet so value is not set
 };
 
 struct InputStream
 {
-	std::unique_ptr<std::string> content;
+	std::shared_ptr<pmr::string> content; ///< Shared with checkpoints of the tokenizer
 	re2::StringPiece stream;
 	bool at_end;
 };
@@ -48,49 +60,99 @@ struct InputStream
 template <typename ValueT>
 struct StateInfo
 {
+	std::uint32_t index;
 	std::string name;
 	std::unique_ptr<re2::RE2::Set> re_set;
 	std::vector<Token<ValueT>*> tokens;
+	std::vector<int> set_patterns; ///< Pattern of each regular expression in the set since tokens with matchers are not in the set
+	std::vector<std::uint32_t> candidate_offsets; ///< Candidates for each first byte of the input (and the end of input) are in range [offsets[b], offsets[b + 1])
+	std::vector<int> candidates; ///< Patterns which can match input starting with the given byte
+	std::vector<int> empty_patterns; ///< Patterns which can only ever match empty string
 };
 
+/**
+ * Snapshot of the tokenizer which contains its state and positions in all input streams. Contents of the input
+ * streams are shared, so it costs only a copy of the input stream stack.
+ */
+template <typename ValueT>
+struct TokenizerCheckpoint
+{
+	StateInfo<ValueT>* state;
+	std::vector<InputStream> inputs;
+};
+
+template <typename ValueT>
+class Lexer;
+
 template <typename ValueT>
 class Tokenizer
 {
 public:
+	friend class Lexer<ValueT>;
+
 	using CallbackType = std::function<void(std::string_view)>;
 
 	static constexpr std::string_view DefaultState = "@default";
+	static constexpr std::size_t EndOfInputByte = 256; ///< Index of candidate patterns for the end of input in tokenizer state
+	static constexpr std::ptrdiff_t MaxCandidates = 4; ///< More candidate patterns are matched all at once as a set
 
 	using GrammarType = Grammar<ValueT>;
 	using StateInfoType = StateInfo<ValueT>;
 	using SymbolType = Symbol<ValueT>;
+	using TokenizerCheckpointType = TokenizerCheckpoint<ValueT>;
 	using TokenType = Token<ValueT>;
 	using TokenMatchType = TokenMatch<ValueT>;
 
-	Tokenizer(const GrammarType* grammar) : _grammar(grammar), _tokens(), _state_info(), _input_stack(), _current_state(nullptr), _global_action()
+	Tokenizer(const GrammarType* grammar) : _grammar(grammar), _tokens(), _prepared_states_count(), _state_info(), _states(), _input_stack(), _finished_inputs(),
+		_retain_inputs(false), _current_state(nullptr), _global_action(), _interning_pool(std::make_unique<InterningPool>()),
+		_memory_resource(pmr::get_default_resource()), _matched_patterns(), _track_lookahead(false), _lookahead_end(0)
 	{
 		_current_state = get_or_make_state_info(std::string{DefaultState});
 		add_token("$", nullptr, std::vector<std::string>{std::string{DefaultState}});
 	}
 
+	/**
+	 * Compiles regular expressions of all tokens for each tokenizer state. It can be called again after adding new
+	 * tokens (or making existing tokens active in new states) and only tokenizer states which were changed since the last
+	 * call are recompiled.
+	 */
 	void prepare()
 	{
-		std::string error;
+		std::unordered_set<StateInfoType*> changed_states;
 
+		_prepared_states_count.resize(_tokens.size(), 0);
 		for (const auto& token : _tokens)
 		{
-			for (const auto& state : token->get_active_in_states())
+			const auto& states = token->get_active_in_states();
+			for (auto i = _prepared_states_count[token->get_index()]; i < states.size(); ++i)
 			{
+				auto* state_info = get_or_make_state_info(states[i]);
+				state_info->tokens.push_back(token.get());
+				changed_states.insert(state_info);
+			}
+			_prepared_states_count[token->get_index()] = states.size();
+		}
+
+		// Compiled set of regular expressions can't be extended so we need to build the whole new one
+		std::string error;
+		for (auto* state_info : changed_states)
+		{
+			state_info->re_set = std::make_unique<re2::RE2::Set>(re2::RE2::DefaultOptions, re2::RE2::Anchor::ANCHOR_START);
+			state_info->set_patterns.clear();
+			for (std::size_t i = 0; i < state_info->tokens.size(); ++i)
+			{
+				const auto* token = state_info->tokens[i];
+				if (token->has_matcher())
+					continue;
+
 				error.clear();
-				auto* state_info = get_or_make_state_info(state);
 				state_info->re_set->Add(token->get_pattern(), &error);
-				state_info->tokens.push_back(token.get());
 				assert(error.empty() && "Error when compiling token regexp");
+				state_info->set_patterns.push_back(static_cast<int>(i));
 			}
+			state_info->re_set->Compile();
+			index_candidates(state_info);
 		}
-
-		for (auto&& [name, info] : _state_info)
-			info.re_set->Compile();
 	}
 
 	const std::vector<std::unique_ptr<TokenType>>& get_tokens() const
@@ -109,9 +171,15 @@ public:
 		return _tokens.back().get();
 	}
 
+	TokenType* add_token(typename TokenType::MatcherType matcher, const ByteSet& first_bytes, const SymbolType* symbol, const std::vector<std::string>& states)
+	{
+		_tokens.push_back(std::make_unique<TokenType>(static_cast<std::uint32_t>(_tokens.size()), std::move(matcher), first_bytes, states, symbol));
+		return _tokens.back().get();
+	}
+
 	void push_input_stream(std::istream& stream)
 	{
-		std::string input;
+		pmr::string input(_memory_resource);
 		std::vector<char> block(4096);
 		while (stream.good())
 		{
@@ -119,27 +187,147 @@ public:
 			input.append(std::string_view(block.data(), stream.gcount()));
 		}
 
-		_input_stack.emplace_back(InputStream{std::make_unique<std::string>(std::move(input)), re2::StringPiece{}, false});
+		_input_stack.emplace_back(InputStream{std::make_shared<pmr::string>(std::move(input)), re2::StringPiece{}, false});
 		_input_stack.back().stream = re2::StringPiece{_input_stack.back().content->c_str()};
 	}
 
+	/**
+	 * Content of the popped input stream is kept until the input streams are cleared because lexemes
+	 * of lazy tokens can still refer to it.
+	 */
 	void pop_input_stream()
 	{
+		_finished_inputs.push_back(std::move(_input_stack.back().content));
 		_input_stack.pop_back();
 	}
 
+	/**
+	 * Clears all input streams. If inputs are retained, their contents are kept until they are released
+	 * so string views into them stay valid.
+	 */
 	void clear_input_streams()
 	{
+		if (_retain_inputs)
+		{
+			for (auto& input : _input_stack)
+				_finished_inputs.push_back(std::move(input.content));
+		}
+		else
+			_finished_inputs.clear();
+
 		_input_stack.clear();
 	}
 
+	void set_retain_inputs(bool retain)
+	{
+		_retain_inputs = retain;
+	}
+
+	/**
+	 * Frees contents of all input streams including the retained ones.
+	 */
+	void release_inputs()
+	{
+		_input_stack.clear();
+		_finished_inputs.clear();
+	}
+
+	/**
+	 * Memory resource from which contents of the input streams pushed afterwards are allocated.
+	 */
+	void set_memory_resource(pmr::memory_resource* resource)
+	{
+		_memory_resource = resource;
+	}
+
+	InterningPool* get_interning_pool() const
+	{
+		return _interning_pool.get();
+	}
+
+	/**
+	 * Skips the given number of bytes of the current input stream without reading any tokens from them.
+	 */
+	void skip_input(std::size_t length)
+	{
+		auto& current_input = _input_stack.back();
+		current_input.stream.remove_prefix(std::min(length, static_cast<std::size_t>(current_input.stream.size())));
+	}
+
+	TokenizerCheckpointType checkpoint() const
+	{
+		return TokenizerCheckpointType{_current_state, _input_stack};
+	}
+
+	/**
+	 * Returns the tokenizer into the state and positions in the input streams it had when the checkpoint was created.
+	 */
+	void restore(const TokenizerCheckpointType& checkpoint)
+	{
+		// Input streams pushed after the checkpoint was created can still be referred to by lexemes of lazy tokens
+		for (auto& input : _input_stack)
+		{
+			auto pushed_later = std::none_of(checkpoint.inputs.begin(), checkpoint.inputs.end(), [&](const auto& checkpoint_input) {
+				return checkpoint_input.content == input.content;
+			});
+			if (pushed_later)
+				_finished_inputs.push_back(std::move(input.content));
+		}
+
+		_input_stack = checkpoint.inputs;
+		_current_state = checkpoint.state;
+	}
+
 	void global_action(CallbackType&& global_action)
 	{
 		_global_action = std::move(global_action);
 	}
 
-	std::optional<TokenMatchType> next_token()
+	/**
+	 * Enables tracking of how far in the input tokenizer had to look to read each token, see get_lookahead_end(). It costs
+	 * another match of regular expression for each candidate token, so it's disabled by default.
+	 */
+	void set_track_lookahead(bool track)
+	{
+		_track_lookahead = track;
+		if (_track_lookahead)
+		{
+			for (auto& token : _tokens)
+				token->prepare_prefix_regexp();
+		}
+	}
+
+	/**
+	 * Offset in the current input stream right after the last byte which tokenizer examined while reading the last token
+	 * (including tokens without symbol which it skipped before it). Text after this offset can't change the token.
+	 * Offset one past the end of the input means that the token depends on where the input ends. Only tracked
+	 * if it's enabled by set_track_lookahead().
+	 */
+	std::size_t get_lookahead_end() const
+	{
+		return _lookahead_end;
+	}
+
+	/**
+	 * Offset in the current input stream where the next token will be read from.
+	 */
+	std::size_t get_offset() const
+	{
+		if (_input_stack.empty())
+			return 0;
+
+		const auto& current_input = _input_stack.back();
+		return static_cast<std::size_t>(current_input.stream.data() - current_input.content->data());
+	}
+
+	/**
+	 * Reads the next token from the input. If perform_actions is false, neither global action nor actions
+	 * of tokens are performed and all tokens have default value. Actions of lazy tokens are never performed here,
+	 * the token is returned with the lazy token set instead.
+	 */
+	std::optional<TokenMatchType> next_token(bool perform_actions = true)
 	{
+		_lookahead_end = 0;
 		bool repeat = true;
 		while (repeat)
 		{
@@ -153,36 +341,18 @@ public:
 			auto& current_input = _input_stack.back();
 			if (!current_input.at_end)
 			{
-				// Matched patterns doesn't have to be sorted (used to be in older re2 versions) but we shouldn't count on that
-				std::vector<int> matched_patterns;
-				_current_state->re_set->Match(current_input.stream, &matched_patterns);
+				if (_track_lookahead)
+					_lookahead_end = std::max(_lookahead_end, get_offset() + lookahead(_current_state, current_input.stream));
+
+				auto [best_match, longest_match] = match(_current_state, current_input.stream, _matched_patterns);
 
 				// Haven't matched anything, tokenization failure, we will get into endless loop
-				if (matched_patterns.empty())
+				if (!best_match)
 				{
 					debug_tokenizer("Nothing matched on the current input");
 					return std::nullopt;
 				}
 
-				re2::StringPiece submatch;
-				const TokenType* best_match = nullptr;
-				int longest_match = -1;
-				for (auto pattern_index : matched_patterns)
-				{
-					_current_state->tokens[pattern_index]->get_regexp()->Match(current_input.stream, 0, current_input.stream.size(), re2::RE2::Anchor::ANCHOR_START, &submatch, 1);
-					if (longest_match < static_cast<int>(submatch.size()))
-					{
-						best_match = _current_state->tokens[pattern_index];
-						longest_match = static_cast<int>(submatch.size());
-					}
-					// In case of equal matches, index of tokens chooses which one is it (lower index has higher priority)
-					else if (longest_match == static_cast<int>(submatch.size()))
-					{
-						if (!best_match || best_match->get_index() > pattern_index)
-							best_match = _current_state->tokens[pattern_index];
-					}
-				}
-
 				if (current_input.stream.size() == 0)
 				{
 					debug_tokenizer("Reached end of input");
@@ -196,31 +366,46 @@ public:
 				}
 
 				std::string_view token_str{current_input.stream.data(), static_cast<std::size_t>(longest_match)};
+				auto offset = get_offset();
 				current_input.stream.remove_prefix(longest_match);
 				debug_tokenizer("Matched \'{}\' with token \'{}\' (index {})", token_str, best_match->get_pattern(), best_match->get_index());
 
-				if (_global_action)
+				if (perform_actions && _global_action)
 					_global_action(token_str);
 
-				ValueT value{};
-				if (best_match->has_action())
-					value = best_match->perform_action(token_str);
+				// Tokens without symbol never get to the parser so there is nothing to defer
+				const TokenType* lazy_token = nullptr;
+				bool perform_action = perform_actions && best_match->has_action();
+				if (perform_action && best_match->is_lazy() && best_match->has_symbol())
+				{
+					lazy_token = best_match;
+					perform_action = false;
+				}
+
+				// Value is constructed directly from the result of action because assignment wouldn't keep
+				// allocator of the result for allocator-aware values
+				ValueT value = perform_action ? best_match->perform_action(token_str) : ValueT{};
 
 				if (!best_match->has_symbol())
 					continue;
 
-				return TokenMatchType{best_match->get_symbol(), std::move(value), static_cast<std::size_t>(longest_match)};
+				return TokenMatchType{best_match->get_symbol(), std::move(value), static_cast<std::size_t>(longest_match), offset, token_str, lazy_token};
 			}
 			else
 				debug_tokenizer("At the end of input");
 
 			// There is still something on stack but we've reached the end and noone popped it so return end symbol to parser
-			return _grammar->get_end_of_input_symbol();
+			return TokenMatchType{_grammar->get_end_of_input_symbol(), ValueT{}, 0, get_offset()};
 		}
 
 		return std::nullopt;
 	}
 
+	const std::string& get_state() const
+	{
+		return _current_state->name;
+	}
+
 	void enter_state(const std::string& state)
 	{
 		_current_state = get_state_info(state);
@@ -228,15 +413,178 @@ public:
 	}
 
 private:
+	/**
+	 * Indexes patterns of the tokenizer state by the first byte of the input they can match, so only a few of them
+	 * need to be tried for each token instead of matching the whole set of regular expressions.
+	 */
+	static void index_candidates(StateInfoType* state_info)
+	{
+		std::vector<std::vector<int>> candidates(EndOfInputByte + 1);
+		state_info->empty_patterns.clear();
+		for (std::size_t i = 0; i < state_info->tokens.size(); ++i)
+		{
+			auto pattern_index = static_cast<int>(i);
+
+			// Matchers never match empty string so they are never candidates for the end of input
+			if (state_info->tokens[i]->has_matcher())
+			{
+				const auto& first_bytes = state_info->tokens[i]->get_first_bytes();
+				for (std::size_t byte = 0; byte < EndOfInputByte; ++byte)
+				{
+					if (first_bytes[byte])
+						candidates[byte].push_back(pattern_index);
+				}
+				continue;
+			}
+
+			// All strings which the pattern matches are in range [min, max], so their first bytes are in range [min[0], max[0]]
+			std::string min, max;
+			bool known_range = state_info->tokens[i]->get_regexp()->PossibleMatchRange(&min, &max, 8);
+			if (known_range && max.empty())
+			{
+				state_info->empty_patterns.push_back(pattern_index);
+				candidates[EndOfInputByte].push_back(pattern_index);
+			}
+			else if (!known_range || min.empty())
+			{
+				for (auto& byte_candidates : candidates)
+					byte_candidates.push_back(pattern_index);
+			}
+			else
+			{
+				for (auto byte = static_cast<unsigned char>(min[0]); byte <= static_cast<unsigned char>(max[0]); ++byte)
+				{
+					candidates[byte].push_back(pattern_index);
+					if (byte == 0xFF)
+						break;
+				}
+			}
+		}
+
+		state_info->candidate_offsets.assign(1, 0);
+		state_info->candidates.clear();
+		for (const auto& byte_candidates : candidates)
+		{
+			state_info->candidates.insert(state_info->candidates.end(), byte_candidates.begin(), byte_candidates.end());
+			state_info->candidate_offsets.push_back(static_cast<std::uint32_t>(state_info->candidates.size()));
+		}
+	}
+
+	/**
+	 * Finds the token with the longest match at the start of the input in the given tokenizer state and returns it
+	 * together with the length of the match. Returns nullptr if nothing matched. Matched patterns are only storage
+	 * which is reused between calls.
+	 */
+	static std::pair<const TokenType*, std::size_t> match(const StateInfoType* state, const re2::StringPiece& input, std::vector<int>& matched_patterns)
+	{
+		// Only patterns which can match the first byte are tried. If there are too many of them, it's faster to match
+		// the whole set of regular expressions at once.
+		auto first_byte = input.empty() ? EndOfInputByte : static_cast<unsigned char>(input[0]);
+		auto candidates_begin = state->candidates.begin() + state->candidate_offsets[first_byte];
+		auto candidates_end = state->candidates.begin() + state->candidate_offsets[first_byte + 1];
+		if (candidates_end - candidates_begin > MaxCandidates)
+		{
+			// Matched patterns doesn't have to be sorted (used to be in older re2 versions) but we shouldn't count on that
+			matched_patterns.clear();
+			if (!state->set_patterns.empty())
+				state->re_set->Match(input, &matched_patterns);
+			for (auto& pattern_index : matched_patterns)
+				pattern_index = state->set_patterns[pattern_index];
+
+			// Tokens with matchers are not in the set so they are tried on their own
+			std::copy_if(candidates_begin, candidates_end, std::back_inserter(matched_patterns), [&](auto pattern_index) {
+				return state->tokens[pattern_index]->has_matcher();
+			});
+		}
+		else
+			matched_patterns.assign(candidates_begin, candidates_end);
+
+		re2::StringPiece submatch;
+		const TokenType* best_match = nullptr;
+		int longest_match = -1;
+		auto try_pattern = [&](int pattern_index) {
+			const auto* token = state->tokens[pattern_index];
+			int length;
+			if (token->has_matcher())
+			{
+				length = static_cast<int>(token->match(std::string_view{input.data(), static_cast<std::size_t>(input.size())}));
+				assert(length <= static_cast<int>(input.size()) && "Matcher matched more than the whole input");
+				if (length == 0)
+					return;
+			}
+			else
+			{
+				if (!token->get_regexp()->Match(input, 0, input.size(), re2::RE2::Anchor::ANCHOR_START, &submatch, 1))
+					return;
+				length = static_cast<int>(submatch.size());
+			}
+
+			// In case of equal matches, index of tokens chooses which one is it (lower index has higher priority)
+			if (longest_match < length || (longest_match == length && best_match->get_index() > token->get_index()))
+			{
+				best_match = token;
+				longest_match = length;
+			}
+		};
+
+		for (auto pattern_index : matched_patterns)
+			try_pattern(pattern_index);
+
+		// Patterns matching only empty string can win only if nothing longer matched, so they are not candidates for any byte
+		if (longest_match <= 0)
+		{
+			for (auto pattern_index : state->empty_patterns)
+				try_pattern(pattern_index);
+		}
+
+		return {best_match, best_match ? static_cast<std::size_t>(longest_match) : 0};
+	}
+
+	/**
+	 * Returns how many bytes at the start of the input match() examines in the given tokenizer state. Pattern reads the input
+	 * until its longest prefix which can still be extended into a match and then one more byte which ended it. Size of the input
+	 * plus one means that whole input was read and the end of the input was seen too.
+	 */
+	static std::size_t lookahead(const StateInfoType* state, const re2::StringPiece& input)
+	{
+		// Patterns which are not candidates can't match anything starting with the first byte
+		auto first_byte = input.empty() ? EndOfInputByte : static_cast<unsigned char>(input[0]);
+		auto candidates_begin = state->candidates.begin() + state->candidate_offsets[first_byte];
+		auto candidates_end = state->candidates.begin() + state->candidate_offsets[first_byte + 1];
+
+		std::size_t result = 1;
+		re2::StringPiece submatch;
+		for (auto itr = candidates_begin; itr != candidates_end; ++itr)
+		{
+			// We don't know what matchers or patterns we don't understand look at, so they could have read anything
+			const auto* prefix_regexp = state->tokens[*itr]->get_prefix_regexp();
+			if (!prefix_regexp)
+				return input.size() + 1;
+
+			prefix_regexp->Match(input, 0, input.size(), re2::RE2::Anchor::ANCHOR_START, &submatch, 1);
+			auto viable = static_cast<std::size_t>(submatch.size());
+
+			// Prefix is matched by whole characters but the pattern could still accept part of multibyte character after it
+			auto examined = viable < input.size() && static_cast<unsigned char>(input[viable]) < 0x80 ? viable + 1 : std::min<std::size_t>(viable + 4, input.size() + 1);
+			result = std::max(result, examined);
+		}
+
+		return result;
+	}
+
 	StateInfoType* get_or_make_state_info(const std::string& name)
 	{
 		auto itr = _state_info.find(name);
 		if (itr == _state_info.end())
+		{
 			std::tie(itr, std::ignore) = _state_info.emplace(name, StateInfoType{
+				static_cast<std::uint32_t>(_states.size()),
 				name,
 				std::make_unique<re2::RE2::Set>(re2::RE2::DefaultOptions, re2::RE2::Anchor::ANCHOR_START),
 				std::vector<TokenType*>{}
 			});
+			_states.push_back(&itr->second);
+		}
 		return &itr->second;
 	}
 
@@ -250,11 +598,20 @@ private:
 
 	const GrammarType* _grammar;
 	std::vector<std::unique_ptr<TokenType>> _tokens;
+	std::vector<std::size_t> _prepared_states_count;
 
 	std::unordered_map<std::string, StateInfoType> _state_info;
+	std::vector<StateInfoType*> _states; ///< Tokenizer states by their index
 	std::vector<InputStream> _input_stack;
+	std::vector<std::shared_ptr<pmr::string>> _finished_inputs;
+	bool _retain_inputs;
 	StateInfoType* _current_state;
 	CallbackType _global_action;
+	std::unique_ptr<InterningPool> _interning_pool;
+	pmr::memory_resource* _memory_resource;
+	std::vector<int> _matched_patterns;
+	bool _track_lookahead;
+	std::size_t _lookahead_end;
 };
 
 } // namespace pog
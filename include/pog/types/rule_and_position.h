@@ -0,0 +1,24 @@
+#pragma once
+
+#include <pog/rule.h>
+
+namespace pog {
+
+template <typename ValueT>
+struct RuleAndPosition
+{
+	const Rule<ValueT>* rule;
+	std::size_t position;
+
+	bool operator==(const RuleAndPosition& rhs) const
+	{
+		return rule->get_index() == rhs.rule->get_index() && position == rhs.position;
+	}
+
+	bool operator!=(const RuleAndPosition& rhs) const
+	{
+		return !(*this == rhs);
+	}
+};
+
+} // namespace pog
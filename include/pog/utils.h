@@ -3,6 +3,7 @@
 #include <ctime>
 #include <functional>
 #include <iomanip>
+#include <iterator>
 #include <sstream>
 #include <variant>
 #include <utility>
@@ -50,6 +51,35 @@ inline std::size_t hash_combine(const Rest&... rest)
 	return seed;
 }
 
+/**
+ * Non-owning view of a range given by a pair of iterators. It is used to expose
+ * parts of contiguous storage without allocating a new container.
+ */
+template <typename It>
+class IteratorRange
+{
+public:
+	using value_type = typename std::iterator_traits<It>::value_type;
+	using reference = typename std::iterator_traits<It>::reference;
+	using iterator = It;
+	using const_iterator = It;
+	using size_type = std::size_t;
+
+	IteratorRange() : _begin(), _end() {}
+	IteratorRange(It begin, It end) : _begin(begin), _end(end) {}
+
+	It begin() const { return _begin; }
+	It end() const { return _end; }
+
+	std::size_t size() const { return static_cast<std::size_t>(std::distance(_begin, _end)); }
+	bool empty() const { return _begin == _end; }
+
+	reference operator[](std::size_t index) const { return *(_begin + index); }
+
+private:
+	It _begin, _end;
+};
+
 template<class... Ts> struct overloaded : Ts... { using Ts::operator()...; };
 template<class... Ts> overloaded(Ts...) -> overloaded<Ts...>;
 
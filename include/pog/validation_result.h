@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <pog/symbol.h>
+
+namespace pog {
+
+/**
+ * Result of the validation of the input (see Parser::validate()). If the input isn't valid, it contains
+ * unexpected symbol (or nullptr if the input couldn't be tokenized), offset of the error in the input
+ * and symbols which were expected instead.
+ */
+template <typename ValueT>
+struct ValidationResult
+{
+	bool accepted;
+	const Symbol<ValueT>* unexpected_symbol;
+	std::size_t offset;
+	std::vector<const Symbol<ValueT>*> expected_symbols;
+
+	explicit operator bool() const { return accepted; }
+};
+
+} // namespace pog
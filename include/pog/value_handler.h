@@ -0,0 +1,222 @@
+#pragma once
+
+#include <cassert>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <pog/memory_resource.h>
+#include <pog/rule.h>
+#include <pog/token.h>
+#include <pog/tokenizer.h>
+
+namespace pog {
+
+/**
+ * Keeps semantic values of the symbols on the stack of the parser and performs actions of the rules over them.
+ * Lazy tokens are kept on the stack only as their lexeme until some rule action uses their value.
+ *
+ * Stack can be restored to the checkpoint. Values are not copied when the checkpoint is created. Value which was
+ * on the stack at that time is rather copied into the journal right before it's modified or popped for the first time,
+ * so restoring costs only as much as the number of values changed since the checkpoint.
+ */
+template <typename ValueT>
+class ValueHandler
+{
+public:
+	using RuleType = Rule<ValueT>;
+	using TokenMatchType = TokenMatch<ValueT>;
+	using TokenType = Token<ValueT>;
+
+	struct Checkpoint
+	{
+		std::size_t size;
+		std::size_t journal_size;
+	};
+
+	ValueHandler(pmr::memory_resource* resource = pmr::get_default_resource()) : _values(resource), _action_arg(),
+		_journal(resource), _protected_size(0) {}
+
+	void shift(TokenMatchType&& token)
+	{
+		_values.push_back(StackValue{std::move(token.value), token.lazy_token, token.lexeme});
+	}
+
+	/**
+	 * Pushes value which was already computed elsewhere onto the stack.
+	 */
+	void push(ValueT&& value)
+	{
+		_values.push_back(StackValue{std::move(value), nullptr, {}});
+	}
+
+	void reduce(const RuleType* rule)
+	{
+		// Accumulating rule L -> L X appends value of X to the value of L right on the stack
+		// so the accumulated value never leaves the stack
+		if (rule->is_accumulating())
+		{
+			assert(_values.size() >= 2 && "Stack is too small");
+			save(_values.size() - 2);
+			auto value = std::move(materialize(_values.back()));
+			_values.pop_back();
+			rule->accumulate(materialize(_values.back()), std::move(value));
+			return;
+		}
+
+		// Each symbol on right-hand side of the rule should have record on the stack. Midrule actions
+		// have 0 RHS size but they borrow values of the symbols preceding them.
+		auto args_count = rule->get_number_of_required_arguments_for_action();
+		assert(_values.size() >= args_count && "Stack is too small");
+
+		auto args_begin = _values.end() - args_count;
+		if (!rule->has_action())
+		{
+			if (!rule->is_midrule())
+			{
+				save(_values.size() - args_count);
+				_values.erase(args_begin, _values.end());
+			}
+			if (rule->has_sink())
+				rule->sink(ValueT{});
+			_values.push_back(StackValue{ValueT{}, nullptr, {}});
+			return;
+		}
+
+		// Midrule actions borrow their arguments so they can change them too
+		save(_values.size() - args_count);
+
+		// Storage of arguments is reused between reductions so actions don't allocate it every time
+		for (std::size_t i = 0; i < args_count; ++i)
+		{
+			auto& arg = *(args_begin + i);
+			_action_arg.push_back(arg.lazy_token && !rule->is_argument_used(i) ? ValueT{} : std::move(materialize(arg)));
+		}
+
+		auto action_result = rule->perform_action(std::move(_action_arg));
+
+		// Midrule actions only borrowed arguments and it is returning them back
+		if (rule->is_midrule())
+		{
+			for (std::size_t i = 0; i < args_count; ++i)
+				(args_begin + i)->value = std::move(_action_arg[i]);
+		}
+		// Non-midrule actions actually consumed those arguments so pop them out
+		else
+			_values.erase(args_begin, _values.end());
+
+		_action_arg.clear();
+		if (rule->has_sink())
+		{
+			rule->sink(std::move(action_result));
+			_values.push_back(StackValue{ValueT{}, nullptr, {}});
+		}
+		else
+			_values.push_back(StackValue{std::move(action_result), nullptr, {}});
+	}
+
+	void reset_value()
+	{
+		save(_values.size() - 1);
+		_values.back() = StackValue{ValueT{}, nullptr, {}};
+	}
+
+	ValueT get_result()
+	{
+		save(_values.size() - 1);
+		return std::move(materialize(_values.back()));
+	}
+
+	/**
+	 * Creates checkpoint of the stack. Checkpoints can be restored in any order but restoring the checkpoint
+	 * invalidates all checkpoints created after it.
+	 */
+	Checkpoint checkpoint()
+	{
+		static_assert(std::is_copy_constructible_v<ValueT>, "Value type needs to be copy constructible to create checkpoints");
+
+		_protected_size = _values.size();
+		return Checkpoint{_values.size(), _journal.size()};
+	}
+
+	void restore(const Checkpoint& checkpoint)
+	{
+		assert(_journal.size() >= checkpoint.journal_size && "Restoring invalidated checkpoint");
+
+		// Journal is undone backwards so the value which was saved first (and is therefore the oldest one) wins
+		while (_journal.size() > checkpoint.journal_size)
+		{
+			auto& [index, value] = _journal.back();
+			if (_values.size() <= index)
+				_values.resize(index + 1);
+
+			// Value is replaced instead of assigned to so allocator-aware values keep their allocator
+			_values[index].~StackValue();
+			new (&_values[index]) StackValue(std::move(value));
+			_journal.pop_back();
+		}
+
+		_values.resize(checkpoint.size);
+		_protected_size = checkpoint.size;
+	}
+
+	/**
+	 * Drops all checkpoints, so values are no longer copied before they are changed.
+	 */
+	void release_checkpoints()
+	{
+		_journal.clear();
+		_protected_size = 0;
+	}
+
+private:
+	struct StackValue
+	{
+		ValueT value;
+		const TokenType* lazy_token;
+		std::string_view lexeme;
+	};
+
+	/**
+	 * Saves values from the given index up to the top of the stack into the journal if they are protected by the checkpoint
+	 * and weren't saved yet. Needs to be called before any of them is changed or popped.
+	 */
+	void save(std::size_t index)
+	{
+		if (index >= _protected_size)
+			return;
+
+		if constexpr (std::is_copy_constructible_v<ValueT>)
+		{
+			for (auto i = index; i < _protected_size; ++i)
+				_journal.emplace_back(i, _values[i]);
+		}
+
+		// Everything above this is either saved or was pushed after the last checkpoint
+		_protected_size = index;
+	}
+
+	static ValueT& materialize(StackValue& stack_value)
+	{
+		if (stack_value.lazy_token)
+		{
+			// Placeholder value is replaced instead of assigned to, so allocator-aware values keep allocator
+			// they were created with in the action
+			auto value = stack_value.lazy_token->perform_action(stack_value.lexeme);
+			stack_value.value.~ValueT();
+			new (&stack_value.value) ValueT(std::move(value));
+			stack_value.lazy_token = nullptr;
+		}
+
+		return stack_value.value;
+	}
+
+	pmr::vector<StackValue> _values;
+	std::vector<ValueT> _action_arg;
+	pmr::vector<std::pair<std::size_t, StackValue>> _journal;
+	std::size_t _protected_size; ///< Values below this are protected by the checkpoint and need to be saved before they are changed
+};
+
+} // namespace pog
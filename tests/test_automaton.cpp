@@ -178,3 +178,43 @@ ConstructStates) {
 	EXPECT_EQ(a.get_states()[3]->to_string(), "S -> a S <*> b");
 	EXPECT_EQ(a.get_states()[4]->to_string(), "S -> a S b <*>");
 }
+
+TEST_F(TestAutomaton,
+NumberTransitionsAndReductions) {
+	grammar.set_start_symbol(grammar.add_symbol(SymbolKind::Nonterminal, "S"));
+	new_state(
+		"S", std::vector<std::string>{}, std::vector<std::string>{"a", "S", "b"},
+		"S", std::vector<std::string>{}, std::vector<std::string>{}
+	);
+
+	Automaton<int> a(&grammar);
+	a.construct_states();
+
+	const auto& transitions = a.get_nonterminal_transitions();
+	ASSERT_EQ(transitions.size(), 2u);
+	EXPECT_EQ(transitions[0].state, a.get_state(0));
+	EXPECT_EQ(transitions[0].symbol->get_name(), "S");
+	EXPECT_EQ(transitions[1].state, a.get_state(2));
+	EXPECT_EQ(transitions[1].symbol->get_name(), "S");
+
+	EXPECT_EQ(a.get_nonterminal_transition_id(a.get_state(0), grammar.get_symbol("S")), std::optional<std::uint32_t>{0});
+	EXPECT_EQ(a.get_nonterminal_transition_id(a.get_state(2), grammar.get_symbol("S")), std::optional<std::uint32_t>{1});
+	EXPECT_EQ(a.get_nonterminal_transition_id(a.get_state(1), grammar.get_symbol("S")), std::nullopt);
+	EXPECT_EQ(a.get_nonterminal_transition_id(a.get_state(0), grammar.get_symbol("a")), std::nullopt);
+
+	const auto& reductions = a.get_reductions();
+	ASSERT_EQ(reductions.size(), 3u);
+	EXPECT_EQ(reductions[0].state, a.get_state(0));
+	EXPECT_EQ(reductions[0].rule->to_string(), "S -> <eps>");
+	EXPECT_EQ(reductions[1].state, a.get_state(2));
+	EXPECT_EQ(reductions[1].rule->to_string(), "S -> <eps>");
+	EXPECT_EQ(reductions[2].state, a.get_state(4));
+	EXPECT_EQ(reductions[2].rule->to_string(), "S -> a S b");
+
+	EXPECT_EQ(a.get_reduction_ids(a.get_state(0)), (std::pair<std::uint32_t, std::uint32_t>{0, 1}));
+	EXPECT_EQ(a.get_reduction_ids(a.get_state(1)), (std::pair<std::uint32_t, std::uint32_t>{1, 1}));
+	EXPECT_EQ(a.get_reduction_ids(a.get_state(4)), (std::pair<std::uint32_t, std::uint32_t>{2, 3}));
+
+	EXPECT_EQ(a.get_reduction_id(a.get_state(4), reductions[2].rule), std::optional<std::uint32_t>{2});
+	EXPECT_EQ(a.get_reduction_id(a.get_state(3), reductions[2].rule), std::nullopt);
+}
@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+
+#include <pog/bitset.h>
+
+using namespace pog;
+
+class TestBitset : public ::testing::Test {};
+
+TEST_F(TestBitset,
+DefaultBitset) {
+	Bitset b;
+
+	EXPECT_EQ(b.size(), 0u);
+	EXPECT_TRUE(b.empty());
+	EXPECT_EQ(b.count(), 0u);
+	EXPECT_FALSE(b.test(0));
+	EXPECT_EQ(b.begin(), b.end());
+}
+
+TEST_F(TestBitset,
+SizeIsRoundedToWords) {
+	Bitset b(65);
+
+	EXPECT_EQ(b.size(), 128u);
+	EXPECT_TRUE(b.empty());
+}
+
+TEST_F(TestBitset,
+SetAndReset) {
+	Bitset b(10);
+
+	b.set(1);
+	b.set(5);
+	EXPECT_TRUE(b.test(1));
+	EXPECT_TRUE(b.test(5));
+	EXPECT_FALSE(b.test(2));
+	EXPECT_EQ(b.count(), 2u);
+
+	b.reset(1);
+	EXPECT_FALSE(b.test(1));
+	EXPECT_EQ(b.count(), 1u);
+
+	b.clear();
+	EXPECT_TRUE(b.empty());
+}
+
+TEST_F(TestBitset,
+SetGrows) {
+	Bitset b;
+
+	b.set(200);
+	EXPECT_TRUE(b.test(200));
+	EXPECT_EQ(b.size(), 256u);
+	EXPECT_EQ(b.count(), 1u);
+}
+
+TEST_F(TestBitset,
+Iteration) {
+	Bitset b(200);
+
+	b.set(0);
+	b.set(63);
+	b.set(64);
+	b.set(130);
+	b.set(199);
+
+	std::vector<std::size_t> actual(b.begin(), b.end());
+	EXPECT_EQ(actual, (std::vector<std::size_t>{0, 63, 64, 130, 199}));
+}
+
+TEST_F(TestBitset,
+Merge) {
+	Bitset b1(10), b2(100);
+
+	b1.set(1);
+	b2.set(1);
+	b2.set(70);
+
+	EXPECT_TRUE(b1.merge(b2));
+	EXPECT_TRUE(b1.test(1));
+	EXPECT_TRUE(b1.test(70));
+	EXPECT_EQ(b1.count(), 2u);
+
+	EXPECT_FALSE(b1.merge(b2));
+
+	b2 |= b1;
+	EXPECT_EQ(b2.count(), 2u);
+}
+
+TEST_F(TestBitset,
+Subset) {
+	Bitset b1(10), b2(300);
+
+	EXPECT_TRUE(b1.is_subset_of(b2));
+
+	b1.set(3);
+	EXPECT_FALSE(b1.is_subset_of(b2));
+	EXPECT_TRUE(b2.is_subset_of(b1));
+
+	b2.set(3);
+	b2.set(250);
+	EXPECT_TRUE(b1.is_subset_of(b2));
+	EXPECT_FALSE(b2.is_subset_of(b1));
+}
+
+TEST_F(TestBitset,
+Equality) {
+	Bitset b1(10), b2(300);
+
+	EXPECT_EQ(b1, b2);
+
+	b1.set(3);
+	EXPECT_NE(b1, b2);
+
+	b2.set(3);
+	EXPECT_EQ(b1, b2);
+
+	b2.set(250);
+	EXPECT_NE(b1, b2);
+	EXPECT_NE(b2, b1);
+}
@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+
+#include <pog/cst.h>
+
+using namespace pog;
+
+class TestCst : public ::testing::Test
+{
+public:
+	TestCst() : s(0, SymbolKind::Nonterminal, "S"), a(1, SymbolKind::Nonterminal, "A"), x(2, SymbolKind::Terminal, "x"), y(3, SymbolKind::Terminal, "y") {}
+
+	Symbol<int> s, a, x, y;
+};
+
+TEST_F(TestCst,
+EmptyTree) {
+	Cst<int> cst;
+
+	EXPECT_TRUE(cst.empty());
+	EXPECT_EQ(cst.size(), 0u);
+}
+
+TEST_F(TestCst,
+Reductions) {
+	// S -> A x A
+	// A -> y
+	// A -> <eps>
+	Rule<int> rule_s(0, &s, std::vector<const Symbol<int>*>{&a, &x, &a});
+	Rule<int> rule_a(1, &a, std::vector<const Symbol<int>*>{&y});
+	Rule<int> rule_a_eps(2, &a, std::vector<const Symbol<int>*>{});
+
+	// Input "y x"
+	Cst<int> cst;
+	cst.add_token(&y, 0, 1);
+	cst.add_reduction(&rule_a, 1);
+	cst.add_token(&x, 2, 1);
+	cst.add_reduction(&rule_a_eps, 0);
+	cst.add_reduction(&rule_s, 3);
+
+	ASSERT_EQ(cst.size(), 5u);
+	EXPECT_TRUE(cst[0].is_token());
+	EXPECT_EQ(cst[1].symbol, &a);
+	EXPECT_EQ(cst[1].rule, &rule_a);
+	EXPECT_EQ(cst[1].subtree_size, 2u);
+	EXPECT_EQ(cst[1].offset, 0u);
+	EXPECT_EQ(cst[1].length, 1u);
+	EXPECT_EQ(cst[3].offset, 3u);
+	EXPECT_EQ(cst[3].length, 0u);
+	EXPECT_EQ(cst[4].symbol, &s);
+	EXPECT_EQ(cst[4].child_count, 3u);
+	EXPECT_EQ(cst[4].subtree_size, 5u);
+	EXPECT_EQ(cst[4].offset, 0u);
+	EXPECT_EQ(cst[4].length, 3u);
+
+	auto root = cst.root();
+	EXPECT_EQ(root.get_index(), 4u);
+	auto children = root.children();
+	ASSERT_EQ(children.size(), 3u);
+	EXPECT_EQ(children[0].get_index(), 1u);
+	EXPECT_EQ(children[1].get_index(), 2u);
+	EXPECT_EQ(children[2].get_index(), 3u);
+	EXPECT_EQ(children[1]->symbol, &x);
+	EXPECT_TRUE(children[2].children().empty());
+
+	auto grandchildren = children[0].children();
+	ASSERT_EQ(grandchildren.size(), 1u);
+	EXPECT_EQ(grandchildren[0]->symbol, &y);
+
+	std::vector<std::size_t> visited;
+	cst.visit([&](const auto& cursor) { visited.push_back(cursor.get_index()); });
+	EXPECT_EQ(visited, (std::vector<std::size_t>{0, 1, 2, 3, 4}));
+}
@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+
+#include <pog/bitset.h>
+#include <pog/digraph_algo.h>
+
+using namespace pog;
+
+class TestDigraphAlgo : public ::testing::Test
+{
+public:
+	struct TestRelation
+	{
+		std::size_t size() const { return edges.size(); }
+		const std::vector<std::uint32_t>& operator[](std::uint32_t x) const { return edges[x]; }
+
+		std::vector<std::vector<std::uint32_t>> edges;
+	};
+
+	static Bitset make_set(std::initializer_list<std::size_t> indices)
+	{
+		Bitset result(16);
+		for (auto index : indices)
+			result.set(index);
+		return result;
+	}
+};
+
+TEST_F(TestDigraphAlgo,
+NoEdges) {
+	TestRelation rel{{{}, {}}};
+	std::vector<Bitset> f{make_set({1}), make_set({2})};
+
+	digraph_algo(rel, f);
+
+	EXPECT_EQ(f[0], make_set({1}));
+	EXPECT_EQ(f[1], make_set({2}));
+}
+
+TEST_F(TestDigraphAlgo,
+Chain) {
+	// 0 -> 1 -> 2
+	TestRelation rel{{{1}, {2}, {}}};
+	std::vector<Bitset> f{make_set({0}), make_set({1}), make_set({2})};
+
+	digraph_algo(rel, f);
+
+	EXPECT_EQ(f[0], make_set({0, 1, 2}));
+	EXPECT_EQ(f[1], make_set({1, 2}));
+	EXPECT_EQ(f[2], make_set({2}));
+}
+
+TEST_F(TestDigraphAlgo,
+Cycle) {
+	// 0 -> 1 -> 2 -> 0, 2 -> 3
+	TestRelation rel{{{1}, {2}, {0, 3}, {}}};
+	std::vector<Bitset> f{make_set({0}), make_set({1}), make_set({2}), make_set({3})};
+
+	digraph_algo(rel, f);
+
+	EXPECT_EQ(f[0], make_set({0, 1, 2, 3}));
+	EXPECT_EQ(f[1], make_set({0, 1, 2, 3}));
+	EXPECT_EQ(f[2], make_set({0, 1, 2, 3}));
+	EXPECT_EQ(f[3], make_set({3}));
+}
+
+TEST_F(TestDigraphAlgo,
+CycleEnteredFromOutside) {
+	// 0 -> 1 -> 2 -> 1, 2 -> 3, 3 -> 3
+	TestRelation rel{{{1}, {2}, {1, 3}, {3}}};
+	std::vector<Bitset> f{make_set({0}), make_set({1}), make_set({2}), make_set({3})};
+
+	digraph_algo(rel, f);
+
+	EXPECT_EQ(f[0], make_set({0, 1, 2, 3}));
+	EXPECT_EQ(f[1], make_set({1, 2, 3}));
+	EXPECT_EQ(f[2], make_set({1, 2, 3}));
+	EXPECT_EQ(f[3], make_set({3}));
+}
+
+TEST_F(TestDigraphAlgo,
+LongChain) {
+	// Long chain which would overflow the stack with recursive implementation
+	const std::uint32_t length = 200000;
+	TestRelation rel;
+	std::vector<Bitset> f(length);
+	for (std::uint32_t i = 0; i < length; ++i)
+	{
+		rel.edges.push_back(i + 1 < length ? std::vector<std::uint32_t>{i + 1} : std::vector<std::uint32_t>{});
+		f[i].set(i % 8);
+	}
+
+	digraph_algo(rel, f);
+
+	EXPECT_EQ(f[0], make_set({0, 1, 2, 3, 4, 5, 6, 7}));
+	EXPECT_EQ(f[length - 1], make_set({(length - 1) % 8}));
+}
+
+TEST_F(TestDigraphAlgo,
+TraverseOnlyReachable) {
+	// 0 -> 1 -> 0, 2 -> 0
+	TestRelation rel{{{1}, {0}, {0}}};
+	std::vector<Bitset> f(3);
+	std::vector<std::size_t> depths(3, 0);
+	std::vector<std::uint32_t> entered;
+	auto on_enter = [&](std::uint32_t x) {
+		f[x] = make_set({x});
+		entered.push_back(x);
+	};
+
+	digraph_traverse(rel, f, depths, 0, on_enter);
+
+	EXPECT_EQ(entered, (std::vector<std::uint32_t>{0, 1}));
+	EXPECT_EQ(f[0], make_set({0, 1}));
+	EXPECT_EQ(f[1], make_set({0, 1}));
+
+	// Already finished nodes are not entered again
+	digraph_traverse(rel, f, depths, 2, on_enter);
+
+	EXPECT_EQ(entered, (std::vector<std::uint32_t>{0, 1, 2}));
+	EXPECT_EQ(f[2], make_set({0, 1, 2}));
+}
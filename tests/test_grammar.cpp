@@ -6,6 +6,12 @@ using namespace pog;
 
 class TestGrammar : public ::testing::Test {};
 
+template <typename R>
+auto to_vector(const R& range)
+{
+	return std::vector<typename R::value_type>(range.begin(), range.end());
+}
+
 TEST_F(TestGrammar,
 DefaultGrammar) {
 	Grammar<int> g;
@@ -79,9 +85,9 @@ GetRulesOfSymbol) {
 	auto r3 = g.add_rule(s2, std::vector<const Symbol<int>*>{s1, s3}, [](auto&&) -> int { return 0; });
 
 	EXPECT_EQ(g.get_rules().size(), 3u);
-	EXPECT_EQ(g.get_rules_of_symbol(s1), (std::vector<const Rule<int>*>{r1, r2}));
-	EXPECT_EQ(g.get_rules_of_symbol(s2), (std::vector<const Rule<int>*>{r3}));
-	EXPECT_EQ(g.get_rules_of_symbol(s3), (std::vector<const Rule<int>*>{}));
+	EXPECT_EQ(to_vector(g.get_rules_of_symbol(s1)), (std::vector<const Rule<int>*>{r1, r2}));
+	EXPECT_EQ(to_vector(g.get_rules_of_symbol(s2)), (std::vector<const Rule<int>*>{r3}));
+	EXPECT_EQ(to_vector(g.get_rules_of_symbol(s3)), (std::vector<const Rule<int>*>{}));
 }
 
 TEST_F(TestGrammar,
@@ -98,9 +104,31 @@ GetRulesWithSymbol) {
 	static_cast<void>(r2);
 
 	EXPECT_EQ(g.get_rules().size(), 3u);
-	EXPECT_EQ(g.get_rules_with_symbol(s1), (std::vector<const Rule<int>*>{r3}));
-	EXPECT_EQ(g.get_rules_with_symbol(s2), (std::vector<const Rule<int>*>{r1}));
-	EXPECT_EQ(g.get_rules_with_symbol(s3), (std::vector<const Rule<int>*>{r1, r3}));
+	EXPECT_EQ(to_vector(g.get_rules_with_symbol(s1)), (std::vector<const Rule<int>*>{r3}));
+	EXPECT_EQ(to_vector(g.get_rules_with_symbol(s2)), (std::vector<const Rule<int>*>{r1}));
+	EXPECT_EQ(to_vector(g.get_rules_with_symbol(s3)), (std::vector<const Rule<int>*>{r1, r3}));
+}
+
+TEST_F(TestGrammar,
+GetSymbolOccurrences) {
+	Grammar<int> g;
+
+	auto s1 = g.add_symbol(SymbolKind::Nonterminal, "A");
+	auto s2 = g.add_symbol(SymbolKind::Nonterminal, "B");
+	auto s3 = g.add_symbol(SymbolKind::Nonterminal, "C");
+
+	auto r1 = g.add_rule(s1, std::vector<const Symbol<int>*>{s2, s3, s2}, [](auto&&) -> int { return 0; });
+	auto r2 = g.add_rule(s2, std::vector<const Symbol<int>*>{s3}, [](auto&&) -> int { return 0; });
+
+	EXPECT_EQ(to_vector(g.get_symbol_occurrences(s1)), (std::vector<RuleAndPosition<int>>{}));
+	EXPECT_EQ(to_vector(g.get_symbol_occurrences(s2)), (std::vector<RuleAndPosition<int>>{{r1, 0}, {r1, 2}}));
+	EXPECT_EQ(to_vector(g.get_symbol_occurrences(s3)), (std::vector<RuleAndPosition<int>>{{r1, 1}, {r2, 0}}));
+	EXPECT_EQ(to_vector(g.get_rules_with_symbol(s2)), (std::vector<const Rule<int>*>{r1}));
+
+	// Index needs to be rebuilt after new rule is added
+	auto r3 = g.add_rule(s3, std::vector<const Symbol<int>*>{s1}, [](auto&&) -> int { return 0; });
+	EXPECT_EQ(to_vector(g.get_symbol_occurrences(s1)), (std::vector<RuleAndPosition<int>>{{r3, 0}}));
+	EXPECT_EQ(to_vector(g.get_rules_of_symbol(s3)), (std::vector<const Rule<int>*>{r3}));
 }
 
 TEST_F(TestGrammar,
@@ -115,6 +143,28 @@ StartSymbol) {
 	EXPECT_EQ(g.get_rules()[0].get(), g.get_start_rule());
 }
 
+TEST_F(TestGrammar,
+AdditionalStartSymbol) {
+	Grammar<int> g;
+
+	auto a = g.add_symbol(SymbolKind::Nonterminal, "A");
+	auto b = g.add_symbol(SymbolKind::Nonterminal, "B");
+	g.set_start_symbol(a);
+	g.add_start_symbol(b);
+	g.add_start_symbol(b);
+
+	EXPECT_EQ(g.get_rules().size(), 2u);
+	EXPECT_EQ(g.get_rules()[1]->to_string(), "@start -> @start:B B @end");
+	EXPECT_TRUE(g.get_rules()[1]->is_start_rule());
+	EXPECT_EQ(g.get_additional_start_rules(), (std::vector<const Rule<int>*>{g.get_rules()[1].get()}));
+
+	auto marker = g.get_start_marker(b);
+	ASSERT_NE(marker, nullptr);
+	EXPECT_TRUE(marker->is_terminal());
+	EXPECT_TRUE(marker->is_start_marker());
+	EXPECT_EQ(g.get_start_marker(a), nullptr);
+}
+
 TEST_F(TestGrammar,
 Empty) {
 	Grammar<int> g;
@@ -185,3 +235,126 @@ Follow) {
 	EXPECT_EQ(g.follow(S), (std::unordered_set<const Symbol<int>*>{b}));
 	EXPECT_EQ(g.follow(A), (std::unordered_set<const Symbol<int>*>{}));
 }
+
+TEST_F(TestGrammar,
+Prune) {
+	Grammar<int> g;
+
+	auto a = g.add_symbol(SymbolKind::Terminal, "a");
+	auto b = g.add_symbol(SymbolKind::Terminal, "b");
+	auto c = g.add_symbol(SymbolKind::Terminal, "c");
+	auto S = g.add_symbol(SymbolKind::Nonterminal, "S");
+	auto A = g.add_symbol(SymbolKind::Nonterminal, "A");
+	auto B = g.add_symbol(SymbolKind::Nonterminal, "B");
+	auto C = g.add_symbol(SymbolKind::Nonterminal, "C");
+
+	// S -> A a | B
+	// A -> b | <eps>
+	// B -> B b
+	// C -> c
+	auto r1 = g.add_rule(S, std::vector<const Symbol<int>*>{A, a}, [](auto&&) -> int { return 0; });
+	auto r2 = g.add_rule(S, std::vector<const Symbol<int>*>{B}, [](auto&&) -> int { return 0; });
+	auto r3 = g.add_rule(A, std::vector<const Symbol<int>*>{b}, [](auto&&) -> int { return 0; });
+	auto r4 = g.add_rule(A, std::vector<const Symbol<int>*>{}, [](auto&&) -> int { return 0; });
+	auto r5 = g.add_rule(B, std::vector<const Symbol<int>*>{B, b}, [](auto&&) -> int { return 0; });
+	auto r6 = g.add_rule(C, std::vector<const Symbol<int>*>{c}, [](auto&&) -> int { return 0; });
+	g.set_start_symbol(S);
+
+	auto result = g.prune();
+
+	EXPECT_EQ(result.rules, (std::vector<const Rule<int>*>{r2, r5, r6}));
+	EXPECT_EQ(result.symbols, (std::vector<const Symbol<int>*>{c, B, C}));
+	EXPECT_FALSE(r1->is_pruned());
+	EXPECT_TRUE(r2->is_pruned());
+	EXPECT_FALSE(r3->is_pruned());
+	EXPECT_FALSE(r4->is_pruned());
+	EXPECT_TRUE(r5->is_pruned());
+	EXPECT_TRUE(r6->is_pruned());
+	EXPECT_EQ(to_vector(g.get_rules_of_symbol(S)), (std::vector<const Rule<int>*>{r1}));
+	EXPECT_EQ(to_vector(g.get_rules_with_symbol(b)), (std::vector<const Rule<int>*>{r3}));
+
+	// B becomes productive and C reachable so nothing is pruned anymore
+	auto r7 = g.add_rule(B, std::vector<const Symbol<int>*>{C}, [](auto&&) -> int { return 0; });
+	result = g.prune();
+
+	EXPECT_TRUE(result.rules.empty());
+	EXPECT_TRUE(result.symbols.empty());
+	EXPECT_EQ(to_vector(g.get_rules_of_symbol(B)), (std::vector<const Rule<int>*>{r5, r7}));
+}
+
+TEST_F(TestGrammar,
+PruneNeverRemovesStartRule) {
+	Grammar<int> g;
+
+	auto S = g.add_symbol(SymbolKind::Nonterminal, "S");
+	auto r = g.add_rule(S, std::vector<const Symbol<int>*>{S}, [](auto&&) -> int { return 0; });
+	g.set_start_symbol(S);
+
+	auto result = g.prune();
+
+	EXPECT_EQ(result.rules, (std::vector<const Rule<int>*>{r}));
+	EXPECT_FALSE(g.get_start_rule()->is_pruned());
+}
+
+TEST_F(TestGrammar,
+InlineSymbols) {
+	Grammar<int> g;
+
+	auto a = g.add_symbol(SymbolKind::Terminal, "a");
+	auto b = g.add_symbol(SymbolKind::Terminal, "b");
+	auto c = g.add_symbol(SymbolKind::Terminal, "c");
+	auto S = g.add_symbol(SymbolKind::Nonterminal, "S");
+	auto B = g.add_symbol(SymbolKind::Nonterminal, "B");
+	B->set_inlined(true);
+
+	// S -> a B a
+	// B -> b | c c
+	auto r1 = g.add_rule(S, std::vector<const Symbol<int>*>{a, B, a}, [](auto&& args) -> int { return args[0] + 10 * args[1] + 100 * args[2]; });
+	auto r2 = g.add_rule(B, std::vector<const Symbol<int>*>{b}, [](auto&& args) -> int { return args[0]; });
+	auto r3 = g.add_rule(B, std::vector<const Symbol<int>*>{c, c}, [](auto&& args) -> int { return args[0] + args[1]; });
+	g.set_start_symbol(S);
+
+	g.inline_symbols();
+
+	EXPECT_TRUE(r1->is_inlined());
+	EXPECT_TRUE(r2->is_inlined());
+	EXPECT_TRUE(r3->is_inlined());
+	EXPECT_TRUE(to_vector(g.get_rules_of_symbol(B)).empty());
+
+	auto rules = to_vector(g.get_rules_of_symbol(S));
+	ASSERT_EQ(rules.size(), 2u);
+	EXPECT_EQ(rules[0]->to_string(), "S -> a b a");
+	EXPECT_EQ(rules[1]->to_string(), "S -> a c c a");
+	EXPECT_EQ(rules[0]->perform_action(std::vector<int>{1, 2, 3}), 321);
+	EXPECT_EQ(rules[1]->perform_action(std::vector<int>{1, 2, 3, 4}), 451);
+
+	// Inlining again reuses the rules created before
+	auto rules_count = g.get_rules().size();
+	g.inline_symbols();
+	EXPECT_EQ(g.get_rules().size(), rules_count);
+	EXPECT_EQ(to_vector(g.get_rules_of_symbol(S)), rules);
+}
+
+TEST_F(TestGrammar,
+InlineRecursiveSymbols) {
+	Grammar<int> g;
+
+	auto a = g.add_symbol(SymbolKind::Terminal, "a");
+	auto S = g.add_symbol(SymbolKind::Nonterminal, "S");
+	auto A = g.add_symbol(SymbolKind::Nonterminal, "A");
+	A->set_inlined(true);
+
+	// S -> A
+	// A -> A a | a
+	auto r1 = g.add_rule(S, std::vector<const Symbol<int>*>{A}, [](auto&&) -> int { return 0; });
+	auto r2 = g.add_rule(A, std::vector<const Symbol<int>*>{A, a}, [](auto&&) -> int { return 0; });
+	auto r3 = g.add_rule(A, std::vector<const Symbol<int>*>{a}, [](auto&&) -> int { return 0; });
+	g.set_start_symbol(S);
+
+	g.inline_symbols();
+
+	EXPECT_FALSE(r1->is_inlined());
+	EXPECT_FALSE(r2->is_inlined());
+	EXPECT_FALSE(r3->is_inlined());
+	EXPECT_EQ(g.get_rules().size(), 4u);
+}
@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+
+#include <pog/interning_pool.h>
+
+using namespace pog;
+
+class TestInterningPool : public ::testing::Test {};
+
+TEST_F(TestInterningPool,
+Intern) {
+	InterningPool pool;
+
+	std::string abc1 = "abc", abc2 = "abc", def = "def";
+	auto i1 = pool.intern(abc1);
+	auto i2 = pool.intern(abc2);
+	auto i3 = pool.intern(def);
+
+	EXPECT_EQ(i1, "abc");
+	EXPECT_EQ(i3, "def");
+	EXPECT_EQ(i1.data(), i2.data());
+	EXPECT_NE(i1.data(), abc1.data());
+	EXPECT_EQ(pool.size(), 2u);
+}
+
+TEST_F(TestInterningPool,
+Handles) {
+	InterningPool pool;
+
+	EXPECT_EQ(pool.get_handle("abc"), 0u);
+	EXPECT_EQ(pool.get_handle("def"), 1u);
+	EXPECT_EQ(pool.get_handle("abc"), 0u);
+	EXPECT_EQ(pool.get_handle(""), 2u);
+	EXPECT_EQ(pool.get_handle(""), 2u);
+
+	EXPECT_EQ(pool.get_string(0), "abc");
+	EXPECT_EQ(pool.get_string(1), "def");
+	EXPECT_EQ(pool.get_string(2), "");
+	EXPECT_EQ(pool.intern("def").data(), pool.get_string(1).data());
+}
+
+TEST_F(TestInterningPool,
+StringsStayValid) {
+	InterningPool pool;
+
+	std::string large(InterningPool::BlockSize + 1, 'x');
+	auto first = pool.intern("first");
+	auto large_view = pool.intern(large);
+
+	std::vector<std::string_view> views;
+	for (int i = 0; i < 20000; ++i)
+		views.push_back(pool.intern(std::to_string(i)));
+
+	EXPECT_EQ(first, "first");
+	EXPECT_EQ(large_view, large);
+	for (int i = 0; i < 20000; ++i)
+		EXPECT_EQ(views[i], std::to_string(i));
+}
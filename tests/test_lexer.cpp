@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+
+#include <pog/lexer.h>
+
+using namespace pog;
+
+class TestLexer : public ::testing::Test
+{
+public:
+	TestLexer() : grammar(), tokenizer(&grammar), a(nullptr), b(nullptr) {}
+
+	void SetUp() override
+	{
+		a = grammar.add_symbol(SymbolKind::Terminal, "a");
+		b = grammar.add_symbol(SymbolKind::Terminal, "b");
+
+		tokenizer.add_token("\\s+", nullptr, std::vector<std::string>{"@default", "quoted"});
+		tokenizer.add_token("a+", a, std::vector<std::string>{"@default"})->set_action([](std::string_view str) {
+			return static_cast<int>(str.length());
+		});
+		tokenizer.add_token("b", b, std::vector<std::string>{"@default", "quoted"});
+		tokenizer.add_token("'", nullptr, std::vector<std::string>{"@default"})->set_transition_to_state("quoted");
+		tokenizer.add_token("'", nullptr, std::vector<std::string>{"quoted"})->set_transition_to_state("@default");
+		tokenizer.prepare();
+	}
+
+	Grammar<int> grammar;
+	Tokenizer<int> tokenizer;
+	const Symbol<int>* a;
+	const Symbol<int>* b;
+};
+
+TEST_F(TestLexer,
+Next) {
+	Lexer<int> lexer(&tokenizer, "aaa b");
+
+	auto token = lexer.next();
+	ASSERT_TRUE(token);
+	EXPECT_EQ(token.value().symbol, a->get_index());
+	EXPECT_EQ(token.value().offset, 0u);
+	EXPECT_EQ(token.value().length, 3u);
+	EXPECT_EQ(lexer.get_text(token.value()), "aaa");
+	EXPECT_EQ(lexer.get_value(token.value()), 3);
+	EXPECT_EQ(lexer.get_state_name(token.value()), "@default");
+
+	token = lexer.next();
+	ASSERT_TRUE(token);
+	EXPECT_EQ(token.value().symbol, LexedToken::NoSymbol);
+	EXPECT_EQ(lexer.get_token(token.value())->get_pattern(), "\\s+");
+	EXPECT_EQ(lexer.get_value(token.value()), 0);
+
+	token = lexer.next();
+	ASSERT_TRUE(token);
+	EXPECT_EQ(token.value().symbol, b->get_index());
+	EXPECT_EQ(token.value().offset, 4u);
+	EXPECT_EQ(token.value().length, 1u);
+
+	EXPECT_FALSE(lexer.next());
+	EXPECT_TRUE(lexer.at_end());
+}
+
+TEST_F(TestLexer,
+States) {
+	Lexer<int> lexer(&tokenizer, "b 'b b' b");
+
+	std::vector<LexedToken> tokens;
+	EXPECT_EQ(lexer.read(tokens, 100), 9u);
+	EXPECT_TRUE(lexer.at_end());
+
+	std::vector<std::string> states;
+	for (const auto& token : tokens)
+		states.push_back(lexer.get_state_name(token));
+	EXPECT_EQ(states, (std::vector<std::string>{"@default", "@default", "@default", "quoted", "quoted", "quoted", "quoted", "@default", "@default"}));
+	EXPECT_EQ(lexer.get_state(), "@default");
+}
+
+TEST_F(TestLexer,
+Read) {
+	Lexer<int> lexer(&tokenizer, "a b a b a");
+
+	std::vector<LexedToken> tokens;
+	EXPECT_EQ(lexer.read(tokens, 4), 4u);
+	EXPECT_EQ(lexer.read(tokens, 4), 4u);
+	EXPECT_EQ(lexer.read(tokens, 4), 1u);
+	EXPECT_EQ(tokens.size(), 9u);
+	EXPECT_EQ(tokens.back().offset, 8u);
+	EXPECT_TRUE(lexer.at_end());
+}
+
+TEST_F(TestLexer,
+Error) {
+	Lexer<int> lexer(&tokenizer, "a c");
+
+	std::vector<LexedToken> tokens;
+	EXPECT_EQ(lexer.read(tokens, 100), 2u);
+	EXPECT_FALSE(lexer.at_end());
+	EXPECT_EQ(lexer.get_offset(), 2u);
+}
+
+TEST_F(TestLexer,
+UnavailableTokenInState) {
+	Lexer<int> lexer(&tokenizer, "'a'");
+
+	EXPECT_TRUE(lexer.next());
+	EXPECT_EQ(lexer.get_state(), "quoted");
+	EXPECT_FALSE(lexer.next());
+	EXPECT_FALSE(lexer.at_end());
+
+	lexer.enter_state("@default");
+	auto token = lexer.next();
+	ASSERT_TRUE(token);
+	EXPECT_EQ(token.value().symbol, a->get_index());
+}
@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+
+#include <pog/matchers.h>
+
+using namespace pog;
+
+class TestMatchers : public ::testing::Test {};
+
+TEST_F(TestMatchers,
+Decimal) {
+	auto m = matchers::decimal();
+
+	EXPECT_EQ(m("123+4"), 3u);
+	EXPECT_EQ(m("0"), 1u);
+	EXPECT_EQ(m("99999999999999999999999"), 23u);
+	EXPECT_EQ(m("-1"), 0u);
+	EXPECT_EQ(m("x1"), 0u);
+	EXPECT_EQ(m(""), 0u);
+
+	EXPECT_EQ(matchers::decimal_value<int>("123"), 123);
+	EXPECT_TRUE(m.first_bytes()['7']);
+	EXPECT_FALSE(m.first_bytes()['a']);
+}
+
+TEST_F(TestMatchers,
+Hex) {
+	auto m = matchers::hex();
+
+	EXPECT_EQ(m("0x1F "), 4u);
+	EXPECT_EQ(m("0XabC"), 5u);
+	EXPECT_EQ(m("0x"), 0u);
+	EXPECT_EQ(m("0xg"), 0u);
+	EXPECT_EQ(m("12"), 0u);
+
+	EXPECT_EQ(matchers::hex_value<int>("0x1F"), 31);
+	EXPECT_EQ(matchers::hex_value<int>("ff"), 255);
+	EXPECT_EQ(matchers::hex_value<unsigned>("0XaB"), 171u);
+}
+
+TEST_F(TestMatchers,
+Floating) {
+	auto m = matchers::floating();
+
+	EXPECT_EQ(m("3.14)"), 4u);
+	EXPECT_EQ(m(".5"), 2u);
+	EXPECT_EQ(m("1e-3+"), 4u);
+	EXPECT_EQ(m("42"), 2u);
+	EXPECT_EQ(m("-1.0"), 0u);
+	EXPECT_EQ(m("inf"), 0u);
+	EXPECT_EQ(m("."), 0u);
+	EXPECT_EQ(m("1.e5"), 4u);
+	EXPECT_EQ(m("2e+x"), 1u);
+
+	EXPECT_DOUBLE_EQ(matchers::float_value<double>("1e-3"), 0.001);
+	EXPECT_FLOAT_EQ(matchers::float_value<float>("2.5"), 2.5f);
+	EXPECT_TRUE(m.first_bytes()['.']);
+}
+
+TEST_F(TestMatchers,
+Identifier) {
+	auto m = matchers::identifier();
+
+	EXPECT_EQ(m("foo_bar1 baz"), 8u);
+	EXPECT_EQ(m("_x"), 2u);
+	EXPECT_EQ(m("1x"), 0u);
+	EXPECT_EQ(m(""), 0u);
+
+	EXPECT_TRUE(m.first_bytes()['_']);
+	EXPECT_TRUE(m.first_bytes()['Z']);
+	EXPECT_FALSE(m.first_bytes()['1']);
+}
+
+TEST_F(TestMatchers,
+QuotedString) {
+	auto m = matchers::quoted_string();
+
+	EXPECT_EQ(m("\"abc\" x"), 5u);
+	EXPECT_EQ(m("\"a\\\"b\""), 6u);
+	EXPECT_EQ(m("\"\""), 2u);
+	EXPECT_EQ(m("\"abc"), 0u);
+	EXPECT_EQ(m("\"abc\\\""), 0u);
+	EXPECT_EQ(m("abc"), 0u);
+
+	EXPECT_EQ(matchers::string_value("\"a\\\"b\\n\""), "a\"b\n");
+	EXPECT_EQ(matchers::string_value("\"\""), "");
+
+	auto single = matchers::quoted_string('\'');
+	EXPECT_EQ(single("'a\"b'"), 5u);
+	EXPECT_TRUE(single.first_bytes()['\'']);
+	EXPECT_FALSE(single.first_bytes()['"']);
+}
+
+TEST_F(TestMatchers,
+LineComment) {
+	auto m = matchers::line_comment();
+
+	EXPECT_EQ(m("// abc\nx"), 6u);
+	EXPECT_EQ(m("// abc"), 6u);
+	EXPECT_EQ(m("/ abc"), 0u);
+
+	auto hash = matchers::line_comment("#");
+	EXPECT_EQ(hash("#x\n"), 2u);
+	EXPECT_TRUE(hash.first_bytes()['#']);
+}
+
+TEST_F(TestMatchers,
+FirstBytesOfCallable) {
+	auto callable = [](std::string_view input) -> std::size_t { return input.size(); };
+
+	EXPECT_TRUE(HasFirstBytes<matchers::Identifier>::value);
+	EXPECT_FALSE(HasFirstBytes<decltype(callable)>::value);
+	EXPECT_EQ(get_first_bytes(callable).count(), 256u);
+}
@@ -958,3 +958,1219 @@ GlobalTokenizerAction) {
 	EXPECT_TRUE(result);
 	EXPECT_THAT(location, Pair(Eq(5), Eq(1)));
 }
+
+TEST_F(TestParser,
+LazyTableConstruction) {
+	Parser<int> p;
+
+	p.token(R"(\s+)");
+	p.token(R"(\+)").symbol("+").precedence(0, Associativity::Left);
+	p.token(R"(-)").symbol("-").precedence(0, Associativity::Left);
+	p.token(R"(\*)").symbol("*").precedence(1, Associativity::Left);
+	p.token(R"(\()").symbol("(");
+	p.token(R"(\))").symbol(")");
+	p.token("[0-9]+").symbol("int").action([](std::string_view str) {
+		return std::stoi(std::string{str});
+	});
+
+	p.set_start_symbol("E");
+	p.rule("E")
+		.production("E", "+", "E", [](auto&& args) {
+			return args[0] + args[2];
+		})
+		.production("E", "-", "E", [](auto&& args) {
+			return args[0] - args[2];
+		})
+		.production("E", "*", "E", [](auto&& args) {
+			return args[0] * args[2];
+		})
+		.production("-", "E", [](auto&& args) {
+			return -args[1];
+		}).precedence(2, Associativity::Right)
+		.production("(", "E", ")", [](auto&& args) {
+			return args[1];
+		})
+		.production("int", [](auto&& args) {
+			return args[0];
+		});
+	EXPECT_TRUE(p.prepare(TableConstruction::Lazy));
+
+	std::stringstream input1("2 + 3 * 4 + 5");
+	auto result = p.parse(input1);
+	EXPECT_TRUE(result);
+	EXPECT_EQ(result.value(), 19);
+
+	std::stringstream input2("-(5 - 3) - -10 * (1 + 1)");
+	result = p.parse(input2);
+	EXPECT_TRUE(result);
+	EXPECT_EQ(result.value(), 18);
+
+	try
+	{
+		std::stringstream input3("2 + * 3");
+		p.parse(input3);
+		FAIL() << "Expected syntax error";
+	}
+	catch (const SyntaxError& e)
+	{
+		EXPECT_STREQ(e.what(), "Syntax error: Unexpected *, expected one of -, (, int");
+	}
+}
+
+TEST_F(TestParser,
+ExtendPreparedParser) {
+	Parser<int> p;
+
+	p.token(R"(\s+)");
+	p.token(R"(\+)").symbol("+").precedence(0, Associativity::Left);
+	p.token("[0-9]+").symbol("int").action([](std::string_view str) {
+		return std::stoi(std::string{str});
+	});
+
+	p.set_start_symbol("E");
+	p.rule("E")
+		.production("E", "+", "E", [](auto&& args) {
+			return args[0] + args[2];
+		})
+		.production("int", [](auto&& args) {
+			return args[0];
+		});
+	EXPECT_TRUE(p.prepare());
+
+	std::stringstream input1("2 + 3");
+	auto result = p.parse(input1);
+	EXPECT_TRUE(result);
+	EXPECT_EQ(result.value(), 5);
+
+	try
+	{
+		std::stringstream input2("2 * 3");
+		p.parse(input2);
+		FAIL() << "Expected syntax error";
+	}
+	catch (const SyntaxError& e)
+	{
+		EXPECT_STREQ(e.what(), "Syntax error: Unknown symbol on input, expected one of @end, +");
+	}
+
+	p.token(R"(\*)").symbol("*").precedence(1, Associativity::Left);
+	p.token(R"(\()").symbol("(");
+	p.token(R"(\))").symbol(")");
+	p.rule("E")
+		.production("E", "*", "E", [](auto&& args) {
+			return args[0] * args[2];
+		})
+		.production("(", "E", ")", [](auto&& args) {
+			return args[1];
+		});
+	EXPECT_TRUE(p.prepare());
+
+	std::stringstream input3("2 + 3 * (4 + 1)");
+	result = p.parse(input3);
+	EXPECT_TRUE(result);
+	EXPECT_EQ(result.value(), 17);
+
+	std::stringstream input4("2 + 3");
+	result = p.parse(input4);
+	EXPECT_TRUE(result);
+	EXPECT_EQ(result.value(), 5);
+}
+
+TEST_F(TestParser,
+UnusedRulesArePruned) {
+	Parser<int> p;
+
+	p.token("a").symbol("a");
+	p.token("b").symbol("b");
+
+	p.set_start_symbol("S");
+	p.rule("S")
+		.production("a")
+		.production("B");
+	p.rule("B")
+		.production("B", "b");
+	p.rule("C")
+		.production("b");
+
+	auto report = p.prepare();
+	EXPECT_TRUE(report);
+
+	std::vector<std::string> pruned_rules;
+	for (const auto* rule : report.get_pruned_rules())
+		pruned_rules.push_back(rule->to_string());
+	std::vector<std::string> pruned_symbols;
+	for (const auto* symbol : report.get_pruned_symbols())
+		pruned_symbols.push_back(symbol->get_name());
+
+	EXPECT_EQ(pruned_rules, (std::vector<std::string>{"S -> B", "B -> B b", "C -> b"}));
+	EXPECT_EQ(pruned_symbols, (std::vector<std::string>{"b", "B", "C"}));
+
+	std::stringstream input("a");
+	auto result = p.parse(input);
+	EXPECT_TRUE(result);
+}
+
+TEST_F(TestParser,
+UnitRulesWithoutAction) {
+	Parser<int> p;
+	std::vector<int> numbers;
+
+	p.token("\\s+");
+	p.token("\\+").symbol("+");
+	p.token("\\(").symbol("(");
+	p.token("\\)").symbol(")");
+	p.token("[0-9]+").symbol("num").action([](std::string_view str) {
+		return std::stoi(std::string{str});
+	});
+
+	p.set_start_symbol("S");
+	p.rule("S")
+		.production("E", [](auto&& args) {
+			return args[0] + 100;
+		});
+	p.rule("E")
+		.production("E", "+", "T", [](auto&& args) {
+			return args[0] + args[2] + 1;
+		})
+		.production("T");
+	p.rule("T")
+		.production("F");
+	p.rule("F")
+		.production("num", [&](auto&& args) {
+			numbers.push_back(args[0]);
+			return args[0];
+		})
+		.production("(", "E", ")", [](auto&& args) {
+			return args[1];
+		})
+		.production("G");
+	p.rule("G")
+		.production("num", "num", [](auto&&) {
+			return 0;
+		});
+	EXPECT_TRUE(p.prepare());
+
+	// Unit rules without action still reset the values
+	std::stringstream input1("1 + (2 + 3) + 4");
+	auto result = p.parse(input1);
+	EXPECT_TRUE(result);
+	EXPECT_EQ(result.value(), 102);
+	EXPECT_EQ(numbers, (std::vector<int>{1, 2, 3, 4}));
+
+	try
+	{
+		std::stringstream input2("1 + 2 )");
+		p.parse(input2);
+		FAIL() << "Expected syntax error";
+	}
+	catch (const SyntaxError& e)
+	{
+		EXPECT_STREQ(e.what(), "Syntax error: Unexpected ), expected one of @end, +");
+	}
+
+	try
+	{
+		std::stringstream input3("(1 2");
+		p.parse(input3);
+		FAIL() << "Expected syntax error";
+	}
+	catch (const SyntaxError& e)
+	{
+		EXPECT_STREQ(e.what(), "Syntax error: Unexpected @end, expected one of +, )");
+	}
+}
+
+TEST_F(TestParser,
+InlinedSymbols) {
+	Parser<int> p;
+
+	p.token("\\s+");
+	p.token("\\+").symbol("+").precedence(1, Associativity::Left);
+	p.token("\\*").symbol("*").precedence(2, Associativity::Left);
+	p.token("[0-9]+").symbol("num").action([](std::string_view str) {
+		return std::stoi(std::string{str});
+	});
+
+	p.set_start_symbol("E");
+	p.rule("E")
+		.production("E", "op", "E", [](auto&& args) {
+			switch (args[1])
+			{
+				case 0: return args[0] + args[2];
+				case 1: return args[0] * args[2];
+				default: return args[0] - args[2];
+			}
+		})
+		.production("num", [](auto&& args) {
+			return args[0];
+		});
+	p.rule("op")
+		.inlined()
+		.production("+", [](auto&&) { return 0; })
+		.production("*", [](auto&&) { return 1; });
+
+	// Without inlining, precedence of operators wouldn't be visible in rule E -> E op E
+	auto report = p.prepare();
+	EXPECT_TRUE(report);
+	EXPECT_TRUE(report.get_pruned_rules().empty());
+	EXPECT_TRUE(report.get_pruned_symbols().empty());
+
+	std::stringstream input1("2 + 3 * 4 + 5 * 6");
+	auto result = p.parse(input1);
+	EXPECT_TRUE(result);
+	EXPECT_EQ(result.value(), 44);
+
+	// New productions of inlined symbol are expanded into the rules where it was already inlined
+	p.token("-").symbol("-").precedence(1, Associativity::Left);
+	p.rule("op")
+		.inlined()
+		.production("-", [](auto&&) { return 2; });
+	EXPECT_TRUE(p.prepare());
+
+	std::stringstream input2("20 - 2 * 3 - 4");
+	result = p.parse(input2);
+	EXPECT_TRUE(result);
+	EXPECT_EQ(result.value(), 10);
+}
+
+TEST_F(TestParser,
+Repetitions) {
+	using Value = std::variant<int, std::vector<int>>;
+
+	Parser<Value> p;
+
+	auto append = [](Value& list, Value&& value) {
+		if (!std::holds_alternative<std::vector<int>>(list))
+			list = std::vector<int>{};
+		std::get<std::vector<int>>(list).push_back(std::get<int>(value));
+	};
+
+	p.token("\\s+");
+	p.token("\\[").symbol("[");
+	p.token("\\]").symbol("]");
+	p.token("-").symbol("-").action([](std::string_view) -> Value {
+		return -1;
+	});
+	p.token(";").symbol(";");
+	p.token("[0-9]+").symbol("num").action([](std::string_view str) -> Value {
+		return std::stoi(std::string{str});
+	});
+
+	p.set_start_symbol("lists");
+	p.rule("lists")
+		.production(plus("list", append), [](auto&& args) -> Value {
+			return std::move(args[0]);
+		});
+	p.rule("list")
+		.production("[", star("item", [] { return Value{std::vector<int>{}}; }, append), "]", ";", [](auto&& args) -> Value {
+			int sum = 0;
+			for (auto item : std::get<std::vector<int>>(args[1]))
+				sum += item;
+			return sum;
+		});
+	p.rule("item")
+		.production(opt("-"), "num", [](auto&& args) -> Value {
+			// Missing optional symbol has default value
+			return std::get<int>(args[0]) == -1 ? -std::get<int>(args[1]) : std::get<int>(args[1]);
+		});
+	EXPECT_TRUE(p.prepare());
+
+	std::stringstream input("[1 2 -4]; []; [10];");
+	auto result = p.parse(input);
+	EXPECT_TRUE(result);
+	EXPECT_EQ(std::get<std::vector<int>>(result.value()), (std::vector<int>{-1, 0, 10}));
+}
+
+TEST_F(TestParser,
+RepetitionsInMoreRuleBuilders) {
+	Parser<int> p;
+
+	auto count = [](int& list, int&&) { ++list; };
+	auto count_twice = [](int& list, int&&) { list += 2; };
+
+	p.token("a").symbol("a");
+	p.token("b").symbol("b");
+	p.token("c").symbol("c");
+
+	p.set_start_symbol("S");
+	p.rule("S")
+		.production("b", star("a", count), [](auto&& args) { return args[1]; });
+	p.rule("S")
+		.production("c", star("a", count_twice), [](auto&& args) { return args[1]; });
+	auto report = p.prepare();
+	EXPECT_TRUE(report);
+	EXPECT_EQ(report.number_of_issues(), 0u);
+
+	std::stringstream input1("baaa");
+	auto result = p.parse(input1);
+	EXPECT_TRUE(result);
+	EXPECT_EQ(result.value(), 3);
+
+	std::stringstream input2("caaa");
+	result = p.parse(input2);
+	EXPECT_TRUE(result);
+	EXPECT_EQ(result.value(), 6);
+}
+
+TEST_F(TestParser,
+Validate) {
+	Parser<int> p;
+	int token_actions = 0, rule_actions = 0;
+
+	p.token("\\s+");
+	p.token("\\+").symbol("+");
+	p.token("[0-9]+").symbol("num").action([&](std::string_view str) {
+		token_actions++;
+		return std::stoi(std::string{str});
+	});
+
+	p.set_start_symbol("E");
+	p.rule("E")
+		.production("E", "+", "num", [&](auto&& args) {
+			rule_actions++;
+			return args[0] + args[2];
+		})
+		.production("num", [&](auto&& args) {
+			rule_actions++;
+			return args[0];
+		});
+	EXPECT_TRUE(p.prepare());
+
+	std::stringstream input1("1 + 2 + 3");
+	auto result = p.validate(input1);
+	EXPECT_TRUE(result);
+	EXPECT_EQ(token_actions, 0);
+	EXPECT_EQ(rule_actions, 0);
+
+	std::stringstream input2("1 + 2 3");
+	result = p.validate(input2);
+	EXPECT_FALSE(result);
+	EXPECT_EQ(result.unexpected_symbol->get_name(), "num");
+	EXPECT_EQ(result.offset, 6u);
+	ASSERT_EQ(result.expected_symbols.size(), 2u);
+	EXPECT_EQ(result.expected_symbols[0]->get_name(), "@end");
+	EXPECT_EQ(result.expected_symbols[1]->get_name(), "+");
+
+	std::stringstream input3("1 + ");
+	result = p.validate(input3);
+	EXPECT_FALSE(result);
+	EXPECT_EQ(result.unexpected_symbol->get_name(), "@end");
+	EXPECT_EQ(result.offset, 4u);
+
+	std::stringstream input4("1 + x");
+	result = p.validate(input4);
+	EXPECT_FALSE(result);
+	EXPECT_EQ(result.unexpected_symbol, nullptr);
+	EXPECT_EQ(result.offset, 4u);
+
+	// Parser can still be used for the regular parsing
+	std::stringstream input5("1 + 2 + 3");
+	auto value = p.parse(input5);
+	EXPECT_TRUE(value);
+	EXPECT_EQ(value.value(), 6);
+	EXPECT_EQ(token_actions, 3);
+	EXPECT_EQ(rule_actions, 3);
+}
+
+TEST_F(TestParser,
+LazyTokenActions) {
+	Parser<int> p;
+	int id_actions = 0, num_actions = 0;
+
+	p.token("\\s+");
+	p.token("=").symbol("=");
+	p.token(";").symbol(";");
+	p.token("[a-z]+").symbol("id").lazy().action([&](std::string_view str) {
+		id_actions++;
+		return static_cast<int>(str.length());
+	});
+	p.token("[0-9]+").symbol("num").lazy().action([&](std::string_view str) {
+		num_actions++;
+		return std::stoi(std::string{str});
+	});
+
+	p.set_start_symbol("S");
+	p.rule("S")
+		.production("S", "stmt", [](auto&& args) { return args[0] + args[1]; })
+		.production("stmt", [](auto&& args) { return args[0]; });
+	p.rule("stmt")
+		.production("id", "=", "num", ";", [](auto&& args) {
+			EXPECT_EQ(args[2], 0);
+			return args[0];
+		})
+		.used_arguments({0})
+		.production("num", ";")
+		.production("num", "num", ";", [](auto&& args) { return args[0] + args[1]; });
+	EXPECT_TRUE(p.prepare());
+
+	std::stringstream input("ab = 12; 3; 4 5; xyz = 7;");
+	auto result = p.parse(input);
+	EXPECT_TRUE(result);
+	EXPECT_EQ(result.value(), 14);
+	EXPECT_EQ(id_actions, 2);
+	EXPECT_EQ(num_actions, 2);
+}
+
+TEST_F(TestParser,
+LazyTokensInInlinedRules) {
+	Parser<int> p;
+	int id_actions = 0, num_actions = 0;
+
+	p.token("\\s+");
+	p.token("=").symbol("=");
+	p.token(";").symbol(";");
+	p.token("\\*").symbol("*");
+	p.token("\\.").symbol(".");
+	p.token("[a-z]+").symbol("id").lazy().action([&](std::string_view str) {
+		id_actions++;
+		return static_cast<int>(str.length());
+	});
+	p.token("[0-9]+").symbol("num").lazy().action([&](std::string_view str) {
+		num_actions++;
+		return std::stoi(std::string{str});
+	});
+
+	p.set_start_symbol("S");
+	p.rule("S")
+		.production("S", "stmt", [](auto&& args) { return args[0] + args[1]; })
+		.production("stmt", [](auto&& args) { return args[0]; });
+	p.rule("stmt")
+		.production("target", "=", "num", ";", [](auto&& args) {
+			EXPECT_EQ(args[2], 0);
+			return args[0];
+		})
+		.used_arguments({0});
+	p.rule("target")
+		.inlined()
+		.production("id", [](auto&& args) { return args[0]; })
+		.production("*", "id", [](auto&& args) { return args[1] * 10; })
+		.used_arguments({1})
+		.production("id", ".", "id", [](auto&& args) {
+			EXPECT_EQ(args[2], 0);
+			return args[0];
+		})
+		.used_arguments({0});
+	EXPECT_TRUE(p.prepare());
+
+	// Rules with inlined target keep arguments used by both rules
+	std::stringstream input("ab = 12; *c = 3; d.efg = 4;");
+	auto result = p.parse(input);
+	EXPECT_TRUE(result);
+	EXPECT_EQ(result.value(), 13);
+	EXPECT_EQ(id_actions, 3);
+	EXPECT_EQ(num_actions, 0);
+}
+
+TEST_F(TestParser,
+RetainInput) {
+	Parser<std::string_view> p;
+
+	p.token("\\s+");
+	p.token("[a-z]+").symbol("id").action([](std::string_view str) { return str; });
+
+	p.set_start_symbol("S");
+	p.rule("S")
+		.production("S", "id", [](auto&& args) { return args[0]; })
+		.production("id", [](auto&& args) { return args[0]; });
+	EXPECT_TRUE(p.prepare());
+
+	p.retain_input(true);
+
+	std::stringstream input1("abc def");
+	auto result1 = p.parse(input1);
+	std::stringstream input2("ghi");
+	auto result2 = p.parse(input2);
+
+	ASSERT_TRUE(result1);
+	ASSERT_TRUE(result2);
+	EXPECT_EQ(result1.value(), "abc");
+	EXPECT_EQ(result2.value(), "ghi");
+
+	p.release_input();
+}
+
+TEST_F(TestParser,
+InternedTokens) {
+	Parser<std::vector<std::string_view>> p;
+
+	p.token("\\s+");
+	p.token("[a-z]+").symbol("id").interned().action([](std::string_view str) {
+		return std::vector<std::string_view>{str};
+	});
+
+	p.set_start_symbol("S");
+	p.rule("S")
+		.production("S", "id", [](auto&& args) {
+			args[0].push_back(args[1][0]);
+			return std::move(args[0]);
+		})
+		.production("id", [](auto&& args) { return std::move(args[0]); });
+	EXPECT_TRUE(p.prepare());
+
+	std::stringstream input("abc def abc");
+	auto result = p.parse(input);
+	EXPECT_TRUE(result);
+	ASSERT_EQ(result.value().size(), 3u);
+	EXPECT_EQ(result.value()[0], "abc");
+	EXPECT_EQ(result.value()[1], "def");
+	EXPECT_EQ(result.value()[0].data(), result.value()[2].data());
+	EXPECT_EQ(result.value()[0].data(), p.get_interning_pool().intern("abc").data());
+	EXPECT_EQ(p.get_interning_pool().size(), 2u);
+}
+
+#ifdef __cpp_lib_memory_resource
+TEST_F(TestParser,
+MemoryResource) {
+	using Value = std::pmr::vector<int>;
+
+	struct CountingResource : std::pmr::memory_resource
+	{
+		void* do_allocate(std::size_t bytes, std::size_t alignment) override
+		{
+			allocations++;
+			return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+		}
+
+		void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+		{
+			std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+		{
+			return this == &other;
+		}
+
+		int allocations = 0;
+	};
+
+	Parser<Value> p;
+	CountingResource resource;
+	p.set_memory_resource(&resource);
+	EXPECT_EQ(p.get_memory_resource(), &resource);
+
+	p.token("\\s+");
+	p.token("[0-9]+").symbol("num").action([&](std::string_view str) {
+		return Value({std::stoi(std::string{str})}, p.get_memory_resource());
+	});
+
+	p.set_start_symbol("S");
+	p.rule("S")
+		.production("S", "num", [](auto&& args) {
+			args[0].push_back(args[1][0]);
+			return std::move(args[0]);
+		})
+		.production("num", [](auto&& args) { return std::move(args[0]); });
+	EXPECT_TRUE(p.prepare());
+
+	std::stringstream input("1 2 3 4 5 6 7 8 9 10");
+	auto result = p.parse(input);
+	ASSERT_TRUE(result);
+	EXPECT_EQ(result.value(), (Value{1, 2, 3, 4, 5, 6, 7, 8, 9, 10}));
+	EXPECT_EQ(result.value().get_allocator().resource(), &resource);
+
+	// Values, stacks of the parser and the input are all allocated from the resource
+	EXPECT_GT(resource.allocations, 13);
+}
+#endif
+
+TEST_F(TestParser,
+ParseCst) {
+	Parser<int> p;
+	int actions = 0;
+
+	p.token("\\s+");
+	p.token("\\+").symbol("+");
+	p.token("\\*").symbol("*");
+	p.token("[0-9]+").symbol("num").action([&](std::string_view) { return ++actions; });
+
+	p.set_start_symbol("E");
+	p.rule("E")
+		.production("E", "+", "T", [&](auto&&) { return ++actions; })
+		.production("T", [&](auto&&) { return ++actions; });
+	p.rule("T")
+		.production("T", "*", "num", [&](auto&&) { return ++actions; })
+		.production("num", [&](auto&&) { return ++actions; });
+	EXPECT_TRUE(p.prepare());
+
+	std::stringstream input("1 + 2 * 34");
+	auto cst = p.parse_cst(input);
+	ASSERT_TRUE(cst);
+	EXPECT_EQ(actions, 0);
+
+	std::vector<std::string> nodes;
+	cst.value().visit([&](const auto& cursor) {
+		nodes.push_back(fmt::format("{}:{}:{}:{}", cursor->symbol->get_name(), cursor->child_count, cursor->offset, cursor->length));
+	});
+	EXPECT_EQ(nodes, (std::vector<std::string>{
+		"num:0:0:1", "T:1:0:1", "E:1:0:1", "+:0:2:1", "num:0:4:1", "T:1:4:1", "*:0:6:1", "num:0:8:2", "T:3:4:6", "E:3:0:10"
+	}));
+
+	auto root = cst.value().root();
+	EXPECT_EQ(root->rule->to_string(), "E -> E + T");
+	ASSERT_EQ(root.children().size(), 3u);
+	EXPECT_EQ(root.children()[2]->rule->to_string(), "T -> T * num");
+
+	std::stringstream input2("1 + * 2");
+	EXPECT_THROW(p.parse_cst(input2), SyntaxError);
+}
+
+TEST_F(TestParser,
+ParseLog) {
+	Parser<int> p;
+	std::atomic<int> rule_actions = 0;
+	std::vector<int> midrule_values;
+	std::vector<std::size_t> observed_midrules(200);
+
+	p.token("\\s+");
+	p.token("\\+").symbol("+");
+	p.token(";").symbol(";");
+	p.token("[0-9]+").symbol("num").lazy().action([](std::string_view str) {
+		return std::stoi(std::string{str});
+	});
+
+	p.set_start_symbol("S");
+	p.rule("S")
+		.production("S", "stmt", [&](auto&& args) { rule_actions++; return args[0] + args[1]; })
+		.production("stmt", [&](auto&& args) { rule_actions++; return args[0]; });
+	p.rule("stmt")
+		.production("E", ";", [&](auto&& args) {
+			// Statements are numbered by their value, so each action writes into different element
+			rule_actions++;
+			observed_midrules[(args[0] - 1) / 2] = midrule_values.size();
+			return args[0];
+		})
+		.production("num",
+			[&](auto&& args) {
+				midrule_values.push_back(args[0]);
+				return 0;
+			},
+			"num", ";", [&](auto&& args) { rule_actions++; return args[0] * args[2]; }
+		);
+	p.rule("E")
+		.production("E", "+", "num", [&](auto&& args) { rule_actions++; return args[0] + args[2]; })
+		.production("num", [&](auto&& args) { rule_actions++; return args[0]; });
+	EXPECT_TRUE(p.prepare());
+
+	std::string text;
+	int expected = 0;
+	for (int i = 0; i < 200; ++i)
+	{
+		text += fmt::format("{} + {} + 1;", i, i);
+		expected += 2 * i + 1;
+		if (i % 50 == 0)
+		{
+			text += fmt::format("{} {};", i, 2);
+			expected += 2 * i;
+		}
+	}
+
+	for (std::size_t threads : {1, 4})
+	{
+		rule_actions = 0;
+		midrule_values.clear();
+
+		std::stringstream input(text);
+		auto log = p.parse_log(input);
+		ASSERT_TRUE(log);
+		EXPECT_EQ(rule_actions, 0);
+
+		EXPECT_EQ(log.value().evaluate(threads), expected);
+		EXPECT_EQ(rule_actions, 200 * 5 + 4 * 2);
+		EXPECT_EQ(midrule_values, (std::vector<int>{0, 50, 100, 150}));
+
+		// Actions after midrule action need to see its side effects even if they are evaluated in parallel
+		for (std::size_t i = 0; i < observed_midrules.size(); ++i)
+			EXPECT_EQ(observed_midrules[i], (i + 49) / 50) << "Statement " << i << " with " << threads << " threads";
+	}
+
+	std::stringstream input("1 + ;");
+	EXPECT_THROW(p.parse_log(input), SyntaxError);
+}
+
+TEST_F(TestParser,
+Sink) {
+	Parser<std::vector<int>> p;
+	std::vector<std::vector<int>> entries;
+
+	p.token("\\s+");
+	p.token(";").symbol(";");
+	p.token("[0-9]+").symbol("num").action([](std::string_view str) {
+		return std::vector<int>{std::stoi(std::string{str})};
+	});
+
+	p.set_start_symbol("document");
+	p.rule("document")
+		.production("document", "entry", [](auto&& args) {
+			EXPECT_TRUE(args[0].empty());
+			return std::move(args[1]);
+		})
+		.sink([&](std::vector<int>&& entry) { entries.push_back(std::move(entry)); })
+		.production([](auto&&) { return std::vector<int>{}; });
+	p.rule("entry")
+		.production("nums", ";", [](auto&& args) { return std::move(args[0]); });
+	p.rule("nums")
+		.production("nums", "num", [](auto&& args) {
+			args[0].push_back(args[1][0]);
+			return std::move(args[0]);
+		})
+		.production("num", [](auto&& args) { return std::move(args[0]); });
+	EXPECT_TRUE(p.prepare());
+
+	std::stringstream input("1; 2 3 4; 5 6;");
+	auto result = p.parse(input);
+	ASSERT_TRUE(result);
+	EXPECT_TRUE(result.value().empty());
+	EXPECT_EQ(entries, (std::vector<std::vector<int>>{{1}, {2, 3, 4}, {5, 6}}));
+}
+
+TEST_F(TestParser,
+SinkInParseLog) {
+	Parser<int> p;
+	std::vector<int> entries;
+	auto caller = std::this_thread::get_id();
+
+	p.token("\\s+");
+	p.token(";").symbol(";");
+	p.token("[0-9]+").symbol("num").action([](std::string_view str) {
+		return std::stoi(std::string{str});
+	});
+
+	p.set_start_symbol("document");
+	p.rule("document")
+		.production("document", "entry", [](auto&& args) { return args[0] + args[1]; })
+		.production([](auto&&) { return 0; });
+	p.rule("entry")
+		.production("num", ";", [](auto&& args) {
+			// Slow action makes sure that other threads get to the subtrees if they are evaluated in parallel
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+			return args[0];
+		})
+		.sink([&](int&& entry) {
+			EXPECT_EQ(std::this_thread::get_id(), caller);
+			entries.push_back(entry);
+		});
+	EXPECT_TRUE(p.prepare());
+
+	std::string text;
+	std::vector<int> expected;
+	for (int i = 0; i < 200; ++i)
+	{
+		text += fmt::format("{};", i);
+		expected.push_back(i);
+	}
+
+	for (std::size_t threads : {1, 4})
+	{
+		entries.clear();
+
+		std::stringstream input(text);
+		auto log = p.parse_log(input);
+		ASSERT_TRUE(log);
+		EXPECT_TRUE(entries.empty());
+
+		// Sinks are called on the calling thread in input order even if the rest could be evaluated in parallel
+		EXPECT_EQ(log.value().evaluate(threads), 0);
+		EXPECT_EQ(entries, expected);
+	}
+}
+
+TEST_F(TestParser,
+Checkpoint) {
+	Parser<std::vector<int>> p;
+
+	p.token("\\s+").states("@default", "hex");
+	p.token(";").symbol(";").states("@default", "hex");
+	p.token("[0-9]+").symbol("num").action([](std::string_view str) {
+		return std::vector<int>{std::stoi(std::string{str})};
+	});
+	p.token("[0-9a-f]+").symbol("num").states("hex").action([](std::string_view str) {
+		return std::vector<int>{std::stoi(std::string{str}, nullptr, 16)};
+	});
+	p.end_token().states("@default", "hex");
+
+	p.set_start_symbol("document");
+	p.rule("document")
+		.production(plus("entry", [](std::vector<int>& list, std::vector<int>&& entry) { list.push_back(entry[0]); }), [](auto&& args) {
+			return std::move(args[0]);
+		});
+	p.rule("entry")
+		.production("nums", ";", [](auto&& args) { return std::move(args[0]); });
+	p.rule("nums")
+		.production("nums", "num", [](auto&& args) {
+			args[0][0] += args[1][0];
+			return std::move(args[0]);
+		})
+		.production("num", [](auto&& args) { return std::move(args[0]); });
+	EXPECT_TRUE(p.prepare());
+
+	// Parser stops with token at the offset already read, so the tokenizer state can be changed only for the tokens after it
+	std::stringstream input("10; 20 ; 30 40; 1f;");
+	p.start(input);
+	EXPECT_FALSE(p.parse_until(7));
+	auto checkpoint = p.checkpoint();
+
+	// Entries 20 and 30 40 are appended to the list on the stack before the error
+	EXPECT_THROW(p.finish(), SyntaxError);
+
+	p.restore(checkpoint);
+	p.enter_tokenizer_state("hex");
+	EXPECT_FALSE(p.parse_until(16));
+	auto hex_checkpoint = p.checkpoint();
+	auto result = p.finish();
+	ASSERT_TRUE(result);
+	EXPECT_EQ(result.value(), (std::vector<int>{10, 20, 112, 31}));
+
+	p.restore(hex_checkpoint);
+	result = p.finish();
+	ASSERT_TRUE(result);
+	EXPECT_EQ(result.value(), (std::vector<int>{10, 20, 112, 31}));
+
+	p.restore(checkpoint);
+	EXPECT_THROW(p.finish(), SyntaxError);
+}
+
+TEST_F(TestParser,
+MultipleStartSymbols) {
+	Parser<int> p;
+
+	p.token("\\s+");
+	p.token("=").symbol("=");
+	p.token(";").symbol(";");
+	p.token("\\+").symbol("+");
+	p.token("\\*").symbol("*");
+	p.token("[a-z]+").symbol("id");
+	p.token("[0-9]+").symbol("num").action([](std::string_view str) {
+		return std::stoi(std::string{str});
+	});
+
+	p.set_start_symbol("stmts");
+	p.add_start_symbol("E");
+	p.add_start_symbol("stmt");
+	p.rule("stmts")
+		.production("stmts", "stmt", [](auto&& args) { return args[0] + args[1]; })
+		.production("stmt", [](auto&& args) { return args[0]; });
+	p.rule("stmt")
+		.production("id", "=", "E", ";", [](auto&& args) { return args[2]; });
+	p.rule("E")
+		.production("E", "+", "T", [](auto&& args) { return args[0] + args[2]; })
+		.production("T", [](auto&& args) { return args[0]; });
+	p.rule("T")
+		.production("T", "*", "num", [](auto&& args) { return args[0] * args[2]; })
+		.production("num", [](auto&& args) { return args[0]; });
+	EXPECT_TRUE(p.prepare());
+
+	std::stringstream input1("a = 1 + 2; b = 2 * 3;");
+	auto result = p.parse(input1);
+	ASSERT_TRUE(result);
+	EXPECT_EQ(result.value(), 9);
+
+	std::stringstream input2("a = 1 + 2; b = 2 * 3;");
+	result = p.parse(input2, "stmts");
+	ASSERT_TRUE(result);
+	EXPECT_EQ(result.value(), 9);
+
+	std::stringstream input3("1 + 2 * 3");
+	result = p.parse(input3, "E");
+	ASSERT_TRUE(result);
+	EXPECT_EQ(result.value(), 7);
+
+	std::stringstream input4("a = 4;");
+	result = p.parse(input4, "stmt");
+	ASSERT_TRUE(result);
+	EXPECT_EQ(result.value(), 4);
+
+	std::stringstream input5("a = 4;");
+	try
+	{
+		p.parse(input5, "E");
+		FAIL() << "Expected syntax error";
+	}
+	catch (const SyntaxError& e)
+	{
+		EXPECT_STREQ(e.what(), "Syntax error: Unexpected id, expected one of num");
+	}
+
+	std::stringstream input6("1 + 2 * 3");
+	p.start(input6, "E");
+	result = p.finish();
+	ASSERT_TRUE(result);
+	EXPECT_EQ(result.value(), 7);
+}
+
+TEST_F(TestParser,
+ParseTokens) {
+	Parser<int> p;
+
+	p.token("\\s+");
+	p.token("\\+").symbol("+");
+	p.token("\\*").symbol("*");
+	p.token("[0-9]+").symbol("num").action([](std::string_view str) {
+		return std::stoi(std::string{str});
+	});
+
+	p.set_start_symbol("E");
+	p.add_start_symbol("T");
+	p.rule("E")
+		.production("E", "+", "T", [](auto&& args) { return args[0] + args[2]; })
+		.production("T", [](auto&& args) { return args[0]; });
+	p.rule("T")
+		.production("T", "*", "num", [](auto&& args) { return args[0] * args[2]; })
+		.production("num", [](auto&& args) { return args[0]; });
+	EXPECT_TRUE(p.prepare());
+
+	const auto* plus = p.get_symbol("+");
+	const auto* times = p.get_symbol("*");
+	const auto* num = p.get_symbol("num");
+	ASSERT_NE(plus, nullptr);
+	ASSERT_NE(times, nullptr);
+	ASSERT_NE(num, nullptr);
+	EXPECT_EQ(p.get_symbol("unknown"), nullptr);
+
+	// 1 + 2 * 3
+	std::vector<TokenMatch<int>> tokens = {
+		{num, 1, 1, 0},
+		{plus, 0, 1, 2},
+		{num, 2, 1, 4},
+		{times, 0, 1, 6},
+		{num, 3, 1, 8}
+	};
+
+	auto result = p.parse_tokens(tokens);
+	ASSERT_TRUE(result);
+	EXPECT_EQ(result.value(), 7);
+	EXPECT_EQ(tokens.size(), 5u);
+	EXPECT_EQ(tokens[0].value, 1);
+
+	result = p.parse_tokens(std::vector<TokenMatch<int>>{{num, 2, 1, 0}, {times, 0, 1, 1}, {num, 5, 1, 2}}, "T");
+	ASSERT_TRUE(result);
+	EXPECT_EQ(result.value(), 10);
+
+	int next = 1;
+	result = p.parse_tokens([&]() -> std::optional<TokenMatch<int>> {
+		if (next > 99)
+			return std::nullopt;
+		if (next++ % 2 == 0)
+			return TokenMatch<int>{plus, 0, 1, 0};
+		return TokenMatch<int>{num, 1, 1, 0};
+	});
+	ASSERT_TRUE(result);
+	EXPECT_EQ(result.value(), 50);
+
+	try
+	{
+		p.parse_tokens(std::vector<TokenMatch<int>>{{num, 1, 1, 0}, {plus, 0, 1, 2}, {plus, 0, 1, 4}});
+		FAIL() << "Expected syntax error";
+	}
+	catch (const SyntaxError& e)
+	{
+		EXPECT_STREQ(e.what(), "Syntax error: Unexpected +, expected one of num");
+	}
+
+	try
+	{
+		p.parse_tokens(std::vector<TokenMatch<int>>{{num, 1, 1, 0}, {plus, 0, 1, 2}}, "T");
+		FAIL() << "Expected syntax error";
+	}
+	catch (const SyntaxError& e)
+	{
+		EXPECT_STREQ(e.what(), "Syntax error: Unexpected +, expected one of @end, *");
+	}
+}
+
+TEST_F(TestParser,
+Lexer) {
+	Parser<int> p;
+
+	p.token("\\s+");
+	p.token("\\+").symbol("+");
+	p.token("[0-9]+").symbol("num").action([](std::string_view str) {
+		return std::stoi(std::string{str});
+	});
+
+	p.set_start_symbol("E");
+	p.rule("E")
+		.production("E", "+", "num", [](auto&& args) { return args[0] + args[2]; })
+		.production("num", [](auto&& args) { return args[0]; });
+	EXPECT_TRUE(p.prepare());
+
+	std::string input = "1 + 22";
+	auto lexer = p.lexer(input);
+
+	std::vector<LexedToken> tokens;
+	EXPECT_EQ(lexer.read(tokens, 100), 5u);
+	EXPECT_TRUE(lexer.at_end());
+	EXPECT_EQ(tokens[0].symbol, p.get_symbol("num")->get_index());
+	EXPECT_EQ(tokens[1].symbol, LexedToken::NoSymbol);
+	EXPECT_EQ(tokens[2].symbol, p.get_symbol("+")->get_index());
+	EXPECT_EQ(tokens[4].symbol, p.get_symbol("num")->get_index());
+	EXPECT_EQ(lexer.get_text(tokens[4]), "22");
+	EXPECT_EQ(lexer.get_value(tokens[4]), 22);
+}
+
+TEST_F(TestParser,
+ReparseCst) {
+	Parser<int> p;
+
+	p.token("\\s+");
+	p.token("=").symbol("=");
+	p.token(";").symbol(";");
+	p.token("\\(").symbol("(");
+	p.token("\\)").symbol(")");
+	p.token("\\+").symbol("+");
+	p.token("[a-z]+").symbol("id");
+	p.token("[0-9]+").symbol("num");
+
+	p.set_start_symbol("stmts");
+	p.rule("stmts")
+		.production("stmts", "stmt")
+		.production("stmt");
+	p.rule("stmt")
+		.production("id", "=", "E", ";");
+	p.rule("E")
+		.production("E", "+", "P")
+		.production("P");
+	p.rule("P")
+		.production("(", "E", ")")
+		.production("id")
+		.production("num");
+	EXPECT_TRUE(p.prepare());
+
+	auto to_strings = [](const Cst<int>& cst) {
+		std::vector<std::string> result;
+		cst.visit([&](const auto& node) {
+			result.push_back(fmt::format("{}:{}:{}:{}:{}:{}:{}", node->symbol->get_name(), node->child_count, node->subtree_size, node->offset, node->length, node->state, node->lookahead));
+		});
+		return result;
+	};
+
+	auto check_edit = [&](const std::string& text, std::size_t offset, std::size_t removed, const std::string& inserted) {
+		std::stringstream old_input(text);
+		auto old_cst = p.parse_cst(old_input);
+		ASSERT_TRUE(old_cst);
+
+		auto new_text = text.substr(0, offset) + inserted + text.substr(offset + removed);
+		std::stringstream new_input(new_text);
+		auto expected = p.parse_cst(new_input);
+		ASSERT_TRUE(expected);
+
+		std::stringstream reparse_input(new_text);
+		auto reparsed = p.reparse_cst(old_cst.value(), reparse_input, TextEdit{offset, removed, inserted.length()});
+		ASSERT_TRUE(reparsed);
+		EXPECT_EQ(to_strings(reparsed.value()), to_strings(expected.value())) << "Edit of '" << text << "' to '" << new_text << "'";
+	};
+
+	std::string text = "a = 1; b = (c + 2) + d; e = f + (g + (h + 3)); i = 4;";
+	check_edit(text, 12, 1, "x");
+	check_edit(text, 12, 1, "(y + c)");
+	check_edit(text, 16, 1, "42");
+	check_edit(text, 23, 0, " z = 5;");
+	check_edit(text, 28, 1, "(f)");
+	check_edit(text, 38, 5, "h");
+	check_edit(text, 0, 1, "abc");
+	check_edit(text, 6, 0, " k = k;");
+	check_edit(text, text.length(), 0, " j = 6;");
+
+	std::stringstream old_input(text);
+	auto old_cst = p.parse_cst(old_input);
+	std::stringstream new_input("a = 1; b = (c + 2 + d;");
+	EXPECT_THROW(p.reparse_cst(old_cst.value(), new_input, TextEdit{17, text.length() - 17, 5}), SyntaxError);
+}
+
+TEST_F(TestParser,
+ReparseCstWithLookahead) {
+	Parser<int> p;
+
+	p.token("\\s+");
+	p.token("/\\*([^*]|\\*+[^*/])*\\*+/");
+	p.token("/").symbol("/");
+	p.token("\\*").symbol("*");
+	p.token("[a-z]+").symbol("id");
+
+	p.set_start_symbol("items");
+	p.rule("items")
+		.production("items", "item")
+		.production("item");
+	p.rule("item")
+		.production("id")
+		.production("/")
+		.production("*");
+	EXPECT_TRUE(p.prepare());
+
+	auto to_strings = [](const Cst<int>& cst) {
+		std::vector<std::string> result;
+		cst.visit([&](const auto& node) {
+			result.push_back(fmt::format("{}:{}:{}:{}", node->symbol->get_name(), node->offset, node->length, node->lookahead));
+		});
+		return result;
+	};
+
+	auto check_edit = [&](const std::string& text, std::size_t offset, std::size_t removed, const std::string& inserted) {
+		std::stringstream old_input(text);
+		auto old_cst = p.parse_cst(old_input);
+		ASSERT_TRUE(old_cst);
+
+		auto new_text = text.substr(0, offset) + inserted + text.substr(offset + removed);
+		std::stringstream new_input(new_text);
+		auto expected = p.parse_cst(new_input);
+		ASSERT_TRUE(expected);
+
+		std::stringstream reparse_input(new_text);
+		auto reparsed = p.reparse_cst(old_cst.value(), reparse_input, TextEdit{offset, removed, inserted.length()});
+		ASSERT_TRUE(reparsed);
+		EXPECT_EQ(to_strings(reparsed.value()), to_strings(expected.value())) << "Edit of '" << text << "' to '" << new_text << "'";
+	};
+
+	// Failed match of the unterminated comment read the whole input after the slash
+	std::string text = "a /* b c d e";
+	std::stringstream input(text);
+	auto cst = p.parse_cst(input);
+	ASSERT_TRUE(cst);
+	auto slash = std::find_if(cst.value().get_nodes().begin(), cst.value().get_nodes().end(), [](const auto& node) {
+		return node.is_token() && node.symbol->get_name() == "/";
+	});
+	ASSERT_NE(slash, cst.value().get_nodes().end());
+	EXPECT_EQ(cst.value()[0].lookahead, 1u);
+	EXPECT_EQ(slash->lookahead, text.length() - 2);
+
+	check_edit(text, 12, 0, " */");
+	check_edit(text, 6, 0, "*/");
+	check_edit("a b /* c */ d e", 14, 1, "f */");
+	check_edit("a b /* c */ d e", 4, 0, "x ");
+	check_edit("ab cd ef", 5, 0, "x");
+}
+
+TEST_F(TestParser,
+MatcherTokens) {
+	Parser<int> p;
+
+	p.token("\\s+");
+	p.token(matchers::line_comment("#"));
+	p.token("\\+").symbol("+");
+	p.token(matchers::hex()).symbol("num").action([](std::string_view str) {
+		return matchers::hex_value<int>(str);
+	});
+	p.token(matchers::decimal()).symbol("num").action([](std::string_view str) {
+		return matchers::decimal_value<int>(str);
+	});
+	p.token(matchers::quoted_string()).symbol("str").action([](std::string_view str) {
+		return static_cast<int>(matchers::string_value(str).length());
+	});
+
+	p.set_start_symbol("E");
+	p.rule("E")
+		.production("E", "+", "T", [](auto&& args) { return args[0] + args[2]; })
+		.production("T", [](auto&& args) { return args[0]; });
+	p.rule("T")
+		.production("num", [](auto&& args) { return args[0]; })
+		.production("str", [](auto&& args) { return args[0]; });
+	EXPECT_TRUE(p.prepare());
+
+	std::stringstream input("1 + 0x10 # comment\n+ \"a\\\"b\" + 0");
+	auto result = p.parse(input);
+	ASSERT_TRUE(result);
+	EXPECT_EQ(result.value(), 20);
+
+	std::stringstream bad_input("1 + \"abc");
+	EXPECT_THROW(p.parse(bad_input), SyntaxError);
+}
@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+
+#include <re2/re2.h>
+
+#include <pog/prefix_pattern.h>
+
+using namespace pog;
+
+class TestPrefixPattern : public ::testing::Test
+{
+public:
+	std::size_t viable_length(const std::string& pattern, const std::string& input)
+	{
+		auto prefix = prefix_pattern(pattern);
+		EXPECT_TRUE(prefix) << pattern;
+
+		re2::RE2::Options options;
+		options.set_longest_match(true);
+		re2::RE2 regexp(prefix.value(), options);
+		EXPECT_TRUE(regexp.ok()) << prefix.value();
+
+		re2::StringPiece submatch;
+		EXPECT_TRUE(regexp.Match(input, 0, input.size(), re2::RE2::Anchor::ANCHOR_START, &submatch, 1));
+		return submatch.size();
+	}
+};
+
+TEST_F(TestPrefixPattern,
+Literals) {
+	EXPECT_EQ(viable_length("abc", "abx"), 2u);
+	EXPECT_EQ(viable_length("abc", "abcd"), 3u);
+	EXPECT_EQ(viable_length("abc", "x"), 0u);
+	EXPECT_EQ(viable_length("a\\.b", "a.b"), 3u);
+	EXPECT_EQ(viable_length("\\Q*+\\E", "*+"), 2u);
+	EXPECT_EQ(viable_length("a{b", "a{b"), 3u);
+}
+
+TEST_F(TestPrefixPattern,
+Repetitions) {
+	EXPECT_EQ(viable_length("[a-z]+", "abc = 1"), 3u);
+	EXPECT_EQ(viable_length("(ab)*c", "ababax"), 5u);
+	EXPECT_EQ(viable_length("a{2,3}b", "aab"), 3u);
+	// Bounded repetitions are treated as unbounded which is still safe
+	EXPECT_EQ(viable_length("a{2,3}b", "aaaab"), 5u);
+	EXPECT_EQ(viable_length("ab?c", "acx"), 2u);
+	EXPECT_EQ(viable_length("x*?y", "xxy"), 3u);
+}
+
+TEST_F(TestPrefixPattern,
+Alternations) {
+	EXPECT_EQ(viable_length("abc|abd|x", "abd"), 3u);
+	EXPECT_EQ(viable_length("(?:if|int)\\b", "inx"), 2u);
+	EXPECT_EQ(viable_length("(?i:ab)", "AB"), 2u);
+	EXPECT_EQ(viable_length("(?P<name>a)b", "ab"), 2u);
+}
+
+TEST_F(TestPrefixPattern,
+Comment) {
+	auto pattern = "/\\*([^*]|\\*+[^*/])*\\*+/";
+	EXPECT_EQ(viable_length(pattern, "/* b c d e"), 10u);
+	EXPECT_EQ(viable_length(pattern, "/* b */ c"), 7u);
+	EXPECT_EQ(viable_length(pattern, "/ b"), 1u);
+}
+
+TEST_F(TestPrefixPattern,
+Assertions) {
+	EXPECT_EQ(viable_length("$", "abc"), 0u);
+	EXPECT_EQ(viable_length("^a\\b", "ab"), 1u);
+	EXPECT_EQ(viable_length("[a-z]+(\\b|$)", "ab c"), 2u);
+}
+
+TEST_F(TestPrefixPattern,
+Unsupported) {
+	EXPECT_FALSE(prefix_pattern("(?i)abc"));
+	EXPECT_FALSE(prefix_pattern("(abc"));
+	EXPECT_FALSE(prefix_pattern("abc)"));
+	EXPECT_FALSE(prefix_pattern("[abc"));
+	EXPECT_FALSE(prefix_pattern("*a"));
+}
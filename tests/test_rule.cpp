@@ -104,3 +104,20 @@ Equality) {
 	EXPECT_FALSE(rule1 != rule2);
 	EXPECT_TRUE(rule1 != rule3);
 }
+
+TEST_F(TestRule,
+UsedArguments) {
+	Symbol<int> s1(1, SymbolKind::Nonterminal, "1");
+	Symbol<int> s2(2, SymbolKind::Terminal, "2");
+	Symbol<int> s3(3, SymbolKind::Terminal, "3");
+	Rule<int> rule(42, &s1, std::vector<const Symbol<int>*>{&s2, &s3, &s2}, [](std::vector<int>&&) -> int { return 0; });
+
+	EXPECT_TRUE(rule.is_argument_used(0));
+	EXPECT_TRUE(rule.is_argument_used(1));
+	EXPECT_TRUE(rule.is_argument_used(2));
+
+	rule.set_used_arguments({0, 2});
+	EXPECT_TRUE(rule.is_argument_used(0));
+	EXPECT_FALSE(rule.is_argument_used(1));
+	EXPECT_TRUE(rule.is_argument_used(2));
+}
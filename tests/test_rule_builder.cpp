@@ -146,3 +146,47 @@ EpsilonRuleWithAction) {
 	EXPECT_EQ(grammar.get_rules()[1]->perform_action(std::vector<int>{}), 43);
 	EXPECT_EQ(grammar.get_rules()[1]->perform_action(std::vector<int>{1, 2, 3}), 43);
 }
+
+TEST_F(TestRuleBuilder,
+Inlined) {
+	RuleBuilder<int> rb(&grammar, "A");
+	rb.inlined()
+		.production("a")
+		.production("b");
+	rb.done();
+
+	EXPECT_EQ(grammar.get_rules().size(), 2u);
+	EXPECT_TRUE(grammar.get_symbol("A")->is_inlined());
+	EXPECT_FALSE(grammar.get_symbol("a")->is_inlined());
+}
+
+TEST_F(TestRuleBuilder,
+Repetitions) {
+	RuleBuilder<int> rb(&grammar, "A");
+	rb.production(star("a", [](int& list, int&& value) { list += value; }), plus("b", [] { return 1; }, [](int& list, int&& value) { list *= value; }), opt("c"));
+	rb.done();
+
+	std::vector<std::string> rules;
+	for (const auto& rule : grammar.get_rules())
+		rules.push_back(rule->to_string());
+
+	EXPECT_EQ(rules, (std::vector<std::string>{
+		"_a*#A.0 -> <eps>",
+		"_a*#A.0 -> _a*#A.0 a",
+		"_b+#A.1 -> b",
+		"_b+#A.1 -> _b+#A.1 b",
+		"_c?#A.2 -> <eps>",
+		"_c?#A.2 -> c",
+		"A -> _a*#A.0 _b+#A.1 _c?#A.2"
+	}));
+	EXPECT_FALSE(grammar.get_rules()[0]->has_action());
+	EXPECT_TRUE(grammar.get_rules()[1]->is_accumulating());
+	EXPECT_EQ(grammar.get_rules()[2]->perform_action(std::vector<int>{5}), 5);
+	EXPECT_TRUE(grammar.get_rules()[3]->is_accumulating());
+	EXPECT_FALSE(grammar.get_rules()[4]->has_action());
+	EXPECT_EQ(grammar.get_rules()[5]->perform_action(std::vector<int>{7}), 7);
+
+	int list = 2;
+	grammar.get_rules()[3]->accumulate(list, 3);
+	EXPECT_EQ(list, 6);
+}
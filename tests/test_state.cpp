@@ -53,9 +53,8 @@ AddItem) {
 	auto result1 = state.add_item(Item<int>{&rule1, 0});
 	auto result2 = state.add_item(Item<int>{&rule2, 0});
 	EXPECT_EQ(state.size(), 2u);
-	EXPECT_THAT(result1, Pair(An<const Item<int>*>(), Eq(true)));
-	EXPECT_THAT(result2, Pair(An<const Item<int>*>(), Eq(true)));
-	EXPECT_NE(result1.first, result2.first);
+	EXPECT_TRUE(result1);
+	EXPECT_TRUE(result2);
 }
 
 TEST_F(TestState,
@@ -70,9 +69,8 @@ AddItemAlreadyExists) {
 	auto result1 = state.add_item(Item<int>{&rule1, 0});
 	auto result2 = state.add_item(Item<int>{&rule2, 0});
 	EXPECT_EQ(state.size(), 1u);
-	EXPECT_THAT(result1, Pair(An<const Item<int>*>(), Eq(true)));
-	EXPECT_THAT(result2, Pair(An<const Item<int>*>(), Eq(false)));
-	EXPECT_EQ(result1.first, result2.first);
+	EXPECT_TRUE(result1);
+	EXPECT_FALSE(result2);
 }
 
 TEST_F(TestState,
@@ -89,9 +87,9 @@ ItemsAreSorted) {
 	state.add_item(Item<int>{&rule2, 0});
 	state.add_item(Item<int>{&rule3, 0});
 	EXPECT_EQ(state.size(), 3u);
-	EXPECT_EQ(state.begin()->get()->get_rule()->get_index(), 42u);
-	EXPECT_EQ((state.begin() + 1)->get()->get_rule()->get_index(), 43u);
-	EXPECT_EQ((state.begin() + 2)->get()->get_rule()->get_index(), 44u);
+	EXPECT_EQ(state.begin()->get_rule()->get_index(), 42u);
+	EXPECT_EQ((state.begin() + 1)->get_rule()->get_index(), 43u);
+	EXPECT_EQ((state.begin() + 2)->get_rule()->get_index(), 44u);
 }
 
 TEST_F(TestState,
@@ -104,14 +102,14 @@ ItemAreIterable) {
 	Rule<int> rule3(42, &s1, std::vector<const Symbol<int>*>{&s2, &s3}, [](std::vector<int>&&) -> int { return 0; });
 
 	State<int> state(1);
-	auto result1 = state.add_item(Item<int>{&rule1, 0});
-	auto result2 = state.add_item(Item<int>{&rule2, 0});
-	auto result3 = state.add_item(Item<int>{&rule3, 0});
+	state.add_item(Item<int>{&rule1, 0});
+	state.add_item(Item<int>{&rule2, 0});
+	state.add_item(Item<int>{&rule3, 0});
 
-	auto expected = std::vector<const Item<int>*>{result3.first, result2.first, result1.first};
+	auto expected = std::vector<Item<int>>{Item<int>{&rule3, 0}, Item<int>{&rule2, 0}, Item<int>{&rule1, 0}};
 	std::size_t i = 0;
 	for (const auto& item : state)
-		EXPECT_EQ(item.get(), expected[i++]);
+		EXPECT_EQ(item, expected[i++]);
 }
 
 TEST_F(TestState,
@@ -208,12 +206,12 @@ GetProductionItems) {
 	state.add_item(Item<int>{&rule, 0});
 	state.add_item(Item<int>{&rule, 1});
 
-	auto expected = std::vector<const Item<int>*>{};
-	EXPECT_EQ(state.get_production_items(), expected);
+	EXPECT_TRUE(state.get_production_items().empty());
 
-	auto i = state.add_item(Item<int>{&rule, 2});
-	expected.push_back(i.first);
-	EXPECT_EQ(state.get_production_items(), expected);
+	state.add_item(Item<int>{&rule, 2});
+	auto production_items = state.get_production_items();
+	EXPECT_EQ(production_items.size(), 1u);
+	EXPECT_EQ(*production_items[0], (Item<int>{&rule, 2}));
 }
 
 TEST_F(TestState,
@@ -272,7 +270,35 @@ Kernel) {
 
 	std::vector<std::string> kernel;
 	for (const auto& item : state.get_kernel())
-		kernel.push_back(item->to_string());
+		kernel.push_back(item.to_string());
 
 	EXPECT_EQ(kernel, (std::vector<std::string>{"1 -> 2 <*> 3", "1 -> 2 3 <*>"}));
 }
+
+TEST_F(TestState,
+AddItems) {
+	Symbol<int> s1(1, SymbolKind::Nonterminal, "1");
+	Symbol<int> s2(2, SymbolKind::Nonterminal, "2");
+	Symbol<int> s3(3, SymbolKind::End, "3");
+	Rule<int> rule1(42, &s1, std::vector<const Symbol<int>*>{&s2, &s3}, [](std::vector<int>&&) -> int { return 0; });
+	Rule<int> rule2(43, &s2, std::vector<const Symbol<int>*>{&s3}, [](std::vector<int>&&) -> int { return 0; });
+
+	State<int> state1(1);
+	state1.add_item(Item<int>{&rule1, 1});
+
+	State<int> state2(2);
+	state2.add_item(Item<int>{&rule1, 1});
+	auto hash = state2.get_kernel_hash();
+	state2.add_items(std::vector<Item<int>>{Item<int>{&rule2, 0}, Item<int>{&rule1, 0}, Item<int>{&rule2, 0}});
+
+	EXPECT_EQ(state2.size(), 3u);
+	EXPECT_EQ(state2.get_kernel().size(), 1u);
+	EXPECT_EQ(state2.get_kernel_hash(), hash);
+	EXPECT_EQ(state2.to_string(), "1 -> 2 <*> 3\n1 -> <*> 2 3\n2 -> <*> 3");
+	EXPECT_TRUE(state1 == state2);
+	EXPECT_EQ(StateKernelHash<int>{}(&state1), StateKernelHash<int>{}(&state2));
+
+	state2.add_item(Item<int>{&rule2, 1});
+	EXPECT_EQ(state2.get_kernel().size(), 2u);
+	EXPECT_FALSE(state1 == state2);
+}
@@ -143,3 +143,58 @@ MultipleTokensDescription) {
 	EXPECT_EQ(tokenizer.get_tokens()[1]->get_pattern(), "abc");
 	EXPECT_EQ(tokenizer.get_tokens()[2]->get_pattern(), "def");
 }
+
+TEST_F(TestTokenBuilder,
+InternedToken) {
+	std::vector<std::string_view> received;
+
+	TokenBuilder<int> tb(&grammar, &tokenizer, "abc");
+	tb.interned();
+	tb.action([&](std::string_view str) {
+		received.push_back(str);
+		return static_cast<int>(str.length());
+	});
+	tb.done();
+
+	std::string input1 = "xyz", input2 = "xyz";
+	EXPECT_TRUE(tokenizer.get_tokens()[1]->is_interned());
+	EXPECT_EQ(tokenizer.get_tokens()[1]->perform_action(input1), 3);
+	EXPECT_EQ(tokenizer.get_tokens()[1]->perform_action(input2), 3);
+
+	ASSERT_EQ(received.size(), 2u);
+	EXPECT_EQ(received[0], "xyz");
+	EXPECT_EQ(received[0].data(), received[1].data());
+	EXPECT_EQ(received[0].data(), tokenizer.get_interning_pool()->intern("xyz").data());
+}
+
+TEST_F(TestTokenBuilder,
+MatcherToken) {
+	TokenBuilder<int> tb(&grammar, &tokenizer, matchers::decimal());
+	tb.symbol("num");
+	tb.done();
+
+	EXPECT_EQ(grammar.get_symbols().size(), 3u);
+	EXPECT_EQ(tokenizer.get_tokens().size(), 2u);
+
+	const auto* token = tokenizer.get_tokens()[1].get();
+	EXPECT_TRUE(token->has_matcher());
+	EXPECT_EQ(token->get_regexp(), nullptr);
+	EXPECT_EQ(token->match("12a"), 2u);
+	EXPECT_TRUE(token->get_first_bytes()['0']);
+	EXPECT_FALSE(token->get_first_bytes()['a']);
+}
+
+TEST_F(TestTokenBuilder,
+FullwordMatcherToken) {
+	TokenBuilder<int> tb(&grammar, &tokenizer, [](std::string_view input) -> std::size_t {
+		return input.substr(0, 2) == "if" ? 2 : 0;
+	});
+	tb.fullword();
+	tb.done();
+
+	const auto* token = tokenizer.get_tokens()[1].get();
+	EXPECT_EQ(token->get_first_bytes().count(), 256u);
+	EXPECT_EQ(token->match("if"), 2u);
+	EXPECT_EQ(token->match("if("), 2u);
+	EXPECT_EQ(token->match("iff"), 0u);
+}
@@ -293,3 +293,240 @@ EnterState) {
 	EXPECT_FALSE(t.next_token());
 	t.pop_input_stream();
 }
+
+TEST_F(TestTokenizer,
+PrepareAgainAfterAddingTokens) {
+	auto a = grammar.add_symbol(SymbolKind::Terminal, "a");
+	auto b = grammar.add_symbol(SymbolKind::Terminal, "b");
+
+	Tokenizer<int> t(&grammar);
+
+	t.add_token("aaa", a, std::vector<std::string>{std::string{decltype(t)::DefaultState}});
+	t.prepare();
+
+	std::stringstream input1("aaabbb");
+	t.push_input_stream(input1);
+
+	auto result = t.next_token();
+	EXPECT_TRUE(result);
+	EXPECT_EQ(result.value().symbol, a);
+
+	result = t.next_token();
+	EXPECT_FALSE(result);
+
+	t.add_token("bbb", b, std::vector<std::string>{std::string{decltype(t)::DefaultState}});
+	t.prepare();
+
+	std::stringstream input2("aaabbb");
+	t.clear_input_streams();
+	t.push_input_stream(input2);
+
+	result = t.next_token();
+	EXPECT_TRUE(result);
+	EXPECT_EQ(result.value().symbol, a);
+
+	result = t.next_token();
+	EXPECT_TRUE(result);
+	EXPECT_EQ(result.value().symbol, b);
+
+	result = t.next_token();
+	EXPECT_TRUE(result);
+	EXPECT_EQ(result.value().symbol, grammar.get_end_of_input_symbol());
+}
+
+TEST_F(TestTokenizer,
+NextTokenOffsetsAndActions) {
+	auto a = grammar.add_symbol(SymbolKind::Terminal, "a");
+	auto b = grammar.add_symbol(SymbolKind::Terminal, "b");
+
+	Tokenizer<int> t(&grammar);
+
+	auto token_a = t.add_token("aaa", a, std::vector<std::string>{std::string{decltype(t)::DefaultState}});
+	token_a->set_action([](std::string_view) { return 42; });
+	t.add_token("bbb", b, std::vector<std::string>{std::string{decltype(t)::DefaultState}});
+	t.add_token("ccc", nullptr, std::vector<std::string>{std::string{decltype(t)::DefaultState}});
+	t.prepare();
+
+	std::stringstream input("aaacccbbbaaa");
+	t.push_input_stream(input);
+
+	auto result = t.next_token();
+	EXPECT_EQ(result.value().symbol, a);
+	EXPECT_EQ(result.value().value, 42);
+	EXPECT_EQ(result.value().offset, 0u);
+
+	result = t.next_token();
+	EXPECT_EQ(result.value().symbol, b);
+	EXPECT_EQ(result.value().offset, 6u);
+	EXPECT_EQ(t.get_offset(), 9u);
+
+	result = t.next_token(false);
+	EXPECT_EQ(result.value().symbol, a);
+	EXPECT_EQ(result.value().value, 0);
+	EXPECT_EQ(result.value().offset, 9u);
+
+	result = t.next_token();
+	EXPECT_EQ(result.value().symbol, grammar.get_end_of_input_symbol());
+	EXPECT_EQ(result.value().offset, 12u);
+}
+
+TEST_F(TestTokenizer,
+LazyToken) {
+	auto a = grammar.add_symbol(SymbolKind::Terminal, "a");
+	auto b = grammar.add_symbol(SymbolKind::Terminal, "b");
+
+	Tokenizer<int> t(&grammar);
+
+	auto token_a = t.add_token("a+", a, std::vector<std::string>{std::string{decltype(t)::DefaultState}});
+	token_a->set_action([](std::string_view str) { return static_cast<int>(str.length()); });
+	token_a->set_lazy(true);
+	auto token_b = t.add_token("b+", b, std::vector<std::string>{std::string{decltype(t)::DefaultState}});
+	token_b->set_action([](std::string_view str) { return static_cast<int>(str.length()); });
+	t.prepare();
+
+	std::stringstream input("aaabb");
+	t.push_input_stream(input);
+
+	auto result = t.next_token();
+	EXPECT_EQ(result.value().symbol, a);
+	EXPECT_EQ(result.value().value, 0);
+	EXPECT_EQ(result.value().lexeme, "aaa");
+	EXPECT_EQ(result.value().lazy_token, token_a);
+	EXPECT_EQ(result.value().lazy_token->perform_action(result.value().lexeme), 3);
+
+	result = t.next_token();
+	EXPECT_EQ(result.value().symbol, b);
+	EXPECT_EQ(result.value().value, 2);
+	EXPECT_EQ(result.value().lexeme, "bb");
+	EXPECT_EQ(result.value().lazy_token, nullptr);
+}
+
+TEST_F(TestTokenizer,
+RetainInputs) {
+	auto a = grammar.add_symbol(SymbolKind::Terminal, "a");
+
+	Tokenizer<int> t(&grammar);
+	t.add_token("a+", a, std::vector<std::string>{std::string{decltype(t)::DefaultState}});
+	t.prepare();
+	t.set_retain_inputs(true);
+
+	std::stringstream input1("aaa");
+	t.push_input_stream(input1);
+	auto lexeme1 = t.next_token().value().lexeme;
+	t.clear_input_streams();
+
+	std::stringstream input2("aa");
+	t.push_input_stream(input2);
+	auto lexeme2 = t.next_token().value().lexeme;
+	t.clear_input_streams();
+
+	EXPECT_EQ(lexeme1, "aaa");
+	EXPECT_EQ(lexeme2, "aa");
+
+	t.release_inputs();
+}
+
+TEST_F(TestTokenizer,
+EqualMatchesInState) {
+	auto a = grammar.add_symbol(SymbolKind::Terminal, "a");
+	auto kw = grammar.add_symbol(SymbolKind::Terminal, "if");
+	auto id = grammar.add_symbol(SymbolKind::Terminal, "id");
+
+	Tokenizer<int> t(&grammar);
+
+	t.add_token("x", a, std::vector<std::string>{std::string{decltype(t)::DefaultState}});
+	t.add_token("if", kw, std::vector<std::string>{std::string{decltype(t)::DefaultState}, "state1"});
+	t.add_token("[a-z]+", id, std::vector<std::string>{std::string{decltype(t)::DefaultState}, "state1"});
+	t.add_token("\\s+", nullptr, std::vector<std::string>{std::string{decltype(t)::DefaultState}, "state1"});
+	t.prepare();
+
+	t.enter_state("state1");
+
+	std::stringstream input("if iff x");
+	t.push_input_stream(input);
+
+	auto result = t.next_token();
+	ASSERT_TRUE(result);
+	EXPECT_EQ(result.value().symbol, kw);
+
+	result = t.next_token();
+	ASSERT_TRUE(result);
+	EXPECT_EQ(result.value().symbol, id);
+
+	result = t.next_token();
+	ASSERT_TRUE(result);
+	EXPECT_EQ(result.value().symbol, id);
+}
+
+TEST_F(TestTokenizer,
+MatcherTokens) {
+	auto kw = grammar.add_symbol(SymbolKind::Terminal, "if");
+	auto id = grammar.add_symbol(SymbolKind::Terminal, "id");
+	auto num = grammar.add_symbol(SymbolKind::Terminal, "num");
+	auto real = grammar.add_symbol(SymbolKind::Terminal, "real");
+
+	Tokenizer<int> t(&grammar);
+
+	auto decimal = matchers::decimal();
+	auto floating = matchers::floating();
+	auto identifier = matchers::identifier();
+	t.add_token("if", kw, std::vector<std::string>{std::string{decltype(t)::DefaultState}});
+	t.add_token(decimal, decimal.first_bytes(), num, std::vector<std::string>{std::string{decltype(t)::DefaultState}});
+	t.add_token(floating, floating.first_bytes(), real, std::vector<std::string>{std::string{decltype(t)::DefaultState}});
+	t.add_token(identifier, identifier.first_bytes(), id, std::vector<std::string>{std::string{decltype(t)::DefaultState}});
+	t.add_token("\\s+", nullptr, std::vector<std::string>{std::string{decltype(t)::DefaultState}});
+	t.prepare();
+
+	std::stringstream input("if iff 12 1.5");
+	t.push_input_stream(input);
+
+	std::vector<std::pair<const Symbol<int>*, std::string_view>> expected = {
+		{kw, "if"}, {id, "iff"}, {num, "12"}, {real, "1.5"}
+	};
+	for (const auto& [symbol, lexeme] : expected)
+	{
+		auto result = t.next_token();
+		ASSERT_TRUE(result);
+		EXPECT_EQ(result.value().symbol, symbol);
+		EXPECT_EQ(result.value().lexeme, lexeme);
+	}
+
+	auto result = t.next_token();
+	ASSERT_TRUE(result);
+	EXPECT_EQ(result.value().symbol, grammar.get_end_of_input_symbol());
+}
+
+TEST_F(TestTokenizer,
+MatcherTokensWithManyCandidates) {
+	auto a = grammar.add_symbol(SymbolKind::Terminal, "a");
+	auto b = grammar.add_symbol(SymbolKind::Terminal, "b");
+	auto c = grammar.add_symbol(SymbolKind::Terminal, "c");
+
+	Tokenizer<int> t(&grammar);
+
+	// Matchers without first bytes are candidates for every byte so the set of regular expressions is used
+	auto take = [](std::size_t count) {
+		return [count](std::string_view input) -> std::size_t { return input.size() >= count && input[0] == 'a' ? count : 0; };
+	};
+	t.add_token("a", a, std::vector<std::string>{std::string{decltype(t)::DefaultState}});
+	t.add_token(take(2), ByteSet{}.set(), b, std::vector<std::string>{std::string{decltype(t)::DefaultState}});
+	t.add_token(take(3), ByteSet{}.set(), c, std::vector<std::string>{std::string{decltype(t)::DefaultState}});
+	t.add_token(take(3), ByteSet{}.set(), a, std::vector<std::string>{std::string{decltype(t)::DefaultState}});
+	t.add_token(take(1), ByteSet{}.set(), b, std::vector<std::string>{std::string{decltype(t)::DefaultState}});
+	t.add_token("b+", b, std::vector<std::string>{std::string{decltype(t)::DefaultState}});
+	t.prepare();
+
+	std::stringstream input("aaabbaa");
+	t.push_input_stream(input);
+
+	std::vector<std::pair<const Symbol<int>*, std::string_view>> expected = {
+		{c, "aaa"}, {b, "bb"}, {b, "aa"}
+	};
+	for (const auto& [symbol, lexeme] : expected)
+	{
+		auto result = t.next_token();
+		ASSERT_TRUE(result);
+		EXPECT_EQ(result.value().symbol, symbol);
+		EXPECT_EQ(result.value().lexeme, lexeme);
+	}
+}